@@ -0,0 +1,78 @@
+#include <assert.h>
+#include <stdlib.h>
+#include "arena.h"
+
+#define ARENA_ALIGNMENT 16
+
+struct ArenaOverflow {
+    ArenaOverflow *next;
+};
+
+void ArenaInit(FrameArena *arena, size_t capacity) {
+    arena->base            = malloc(capacity);
+    arena->capacity        = arena->base ? capacity : 0;
+    arena->used            = 0;
+    arena->high_water      = 0;
+    arena->overflow_count  = 0;
+    arena->overflow_bytes  = 0;
+    arena->overflow_frames = 0;
+    arena->overflow        = NULL;
+}
+
+static void FreeOverflow(FrameArena *arena) {
+    while (arena->overflow) {
+        ArenaOverflow *next = arena->overflow->next;
+        free(arena->overflow);
+        arena->overflow = next;
+    }
+}
+
+void ArenaFree(FrameArena *arena) {
+    FreeOverflow(arena);
+    free(arena->base);
+    arena->base = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+void* ArenaAlloc(FrameArena *arena, size_t size) {
+    size_t start = (arena->used + ARENA_ALIGNMENT-1) & ~(size_t)(ARENA_ALIGNMENT-1);
+
+    if (start+size <= arena->capacity) {
+        arena->used = start+size;
+        return arena->base+start;
+    }
+
+    //full, fall back to the heap until the next reset
+    ArenaOverflow *block = malloc(ARENA_ALIGNMENT+size);
+
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = arena->overflow;
+    arena->overflow = block;
+    arena->overflow_count++;
+    arena->overflow_bytes += size;
+
+    return (unsigned char*)block + ARENA_ALIGNMENT;
+}
+
+void ArenaReset(FrameArena *arena) {
+    size_t frame_total = arena->used + arena->overflow_bytes;
+
+    if (frame_total > arena->high_water) {
+        arena->high_water = frame_total;
+    }
+
+    if (arena->overflow_count > 0) {
+        arena->overflow_frames++;
+    }
+
+    assert(arena->overflow_count == 0 && "frame arena overflowed, make it bigger");
+
+    FreeOverflow(arena);
+    arena->used = 0;
+    arena->overflow_count = 0;
+    arena->overflow_bytes = 0;
+}
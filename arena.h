@@ -0,0 +1,40 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+/*
+    Bump pointer arena for memory that only lives for one frame. Reset it
+    once per frame and every ArenaAlloc since the last reset is gone.
+
+    If a frame asks for more than the arena holds the extra comes from
+    malloc so nothing breaks, but that defeats the point: debug builds
+    assert on it when the arena is reset. high_water tells you how big to
+    make it.
+*/
+
+#include <stddef.h>
+
+typedef struct ArenaOverflow ArenaOverflow;
+
+typedef struct FrameArena {
+    unsigned char *base;
+    size_t capacity;
+    size_t used;
+    //most bytes used in any one frame, including overflow
+    size_t high_water;
+    //heap allocations made this frame because the arena was full
+    int overflow_count;
+    size_t overflow_bytes;
+    //frames that needed the heap since ArenaInit
+    int overflow_frames;
+    ArenaOverflow *overflow;
+} FrameArena;
+
+void ArenaInit(FrameArena *arena, size_t capacity);
+void ArenaFree(FrameArena *arena);
+
+//16 byte aligned, never NULL unless malloc fails
+void* ArenaAlloc(FrameArena *arena, size_t size);
+
+void ArenaReset(FrameArena *arena);
+
+#endif
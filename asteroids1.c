@@ -1,490 +1,371 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "raylib.h"
 #include "raymath.h"
+#include "rlgl.h"
 #include <math.h>
+#include <time.h>
+#include "game.h"
+#include "arena.h"
+#include "batch.h"
+#include "draw.h"
+#include "atlas.h"
+#include "starfield.h"
+#include "governor.h"
+#include "pipeline.h"
+#include "profile.h"
+#include "replay.h"
+#include "snapshot.h"
 
-
-typedef struct GameData {
-    //Player data
-    Vector2 player_position;
-    Vector2 player_velocity;
-    float player_acceleration;
-    float player_rotation;
-    float player_rotational_velocity;
-    //Asteroid data 
-    Vector2 *asteroid_positions;
-    Vector2 *asteroid_velocities;
-    float *asteroid_rotation;
-    float *asteroid_rotational_velocity;
-    int *asteroid_sizes;
-    int asteroid_count;
-    int max_asteroids;
-    //Particle data 
-    Vector2 *particle_positions;
-    Vector2 *particle_velocities;
-    float *particle_time;
-    int max_particles;
-    int particle_count;
-    //Missile data 
-    Vector2 *missile_positions;
-    Vector2 *missile_velocities;
-    int missile_count;
-    int max_missiles;
-    //GameData 
-    int screen_height;
-    int screen_width;
-    int lives;
-    float invicibility_time;
-    float player_cooldown;
-}GameData;
+//Transient render buffers for one frame, see the high water mark printed on exit
+#define FRAME_ARENA_SIZE (64*1024)
+//Where F7 writes the save state and F8 looks for one if none was made this run
+#define SAVE_STATE_PATH "quicksave.snap"
 
 /*
-    Physics Functions
+    Simulation rate. The game was tuned at 144 FPS and some of it still
+    counts ticks rather than seconds (thrust build up, one thrust particle
+    per tick), so this keeps it playing the same.
 */
+#define TICK_RATE 144
+//More ticks than this in one frame and the game slows down instead
+#define MAX_TICKS_PER_FRAME 8
+
+//F3 cycles through these, topping the particle pool up to each every frame
+static const int stress_levels[] = {0, 10000, 100000, 1000000};
+#define STRESS_LEVEL_COUNT 4
+
 
-Vector2 UpdatePosition(Vector2 pos, Vector2 velocity, int screen_width, int screen_height, bool wrap) {
-    Vector2 v = Vector2Add(pos, velocity);
+//Prepares a list for drawing vector graphic, valid until the frame arena is reset
+Vector2* RenderTranslation(FrameArena *arena, Vector2 *array, int array_length, float rotation, Vector2 position, float scale) {
+    Vector2 *translated = ArenaAlloc(arena, sizeof(Vector2)*array_length);
+    /*Multiply the rotation angle by to_radians to convert angle in to radians to
+      be used by Vector2 manipulation functions
+    */
+    float to_radians = 0.01745f;
     
-    if (wrap) {
-        //Wrap
-        if (v.x < -15) {
-            v.x += screen_width+15;
-        }
-        
-        if (v.y < -15) {
-            v.y = screen_height+15;
-        }
-        
-        if (v.x > screen_width+15) {
-            v.x =-15;
-        }
-        
-        if (v.y > screen_height+15) {
-            v.y = -15;
-        }
+    for (int i = 0; i < array_length; i++) {
+        //Load coordinates in to translation array 
+        translated[i] = array[i];
+        //fix coordinates from bottem left origin to top left origin 
+        translated[i].y *= -1.0f;
+        //Rotate
+        translated[i] = Vector2Rotate(translated[i], rotation*to_radians);
+        //Scale
+        translated[i] = Vector2Scale(translated[i], scale);
+        //Translate
+        translated[i] = Vector2Add(position, translated[i]);
     }
     
-    return v;
-}
-
-
-Vector2 UpdateVelocity(Vector2 velocity, float acceleration, float rotation, float delta_time) {
-    float to_radians = 0.017453;
-    float r = rotation+90;
-    Vector2 v = velocity;
-    v.x += (acceleration*(-1.0f*cos(r*to_radians)))*delta_time;
-    v.y += (acceleration*(-1.0f*sin(r*to_radians)))*delta_time;
-    return v;    
+    return translated;
 }
 
-//change_in_degrees indicates how much the object will rotate in 1 second
-float UpdateRotation(float current_rotation, float change_in_degrees, float delta_time) {
-    float rotation = current_rotation+(change_in_degrees*delta_time);
-    //switch to modulo
+//Degrees, the short way round
+float LerpAngle(float from, float to, float alpha) {
+    float difference = to-from;
     
-    if (rotation > 360) {
-        rotation -= 360;
+    if (difference > 180) {
+        difference -= 360;
     }
     
-    if (rotation < 0) {
-        rotation += 360;
+    if (difference < -180) {
+        difference += 360;
     }
     
-    return rotation;
+    return from + difference*alpha;
 }
 
+#ifdef PROFILE
 /*
-    Game Functions
+    Profiler breakdown over the last PROFILE_HISTORY frames, GameStep phases
+    indented. The gauges are the ones view was made with, the profiler's own
+    are being set by the simulation while this draws.
 */
-
-GameData* InitNewGame(const int screen_height, const int screen_width, int max_asteroids, int max_particles, int max_missiles) {
-    GameData *new_game = malloc(sizeof(GameData));
-    Vector2 player_pos;
-    player_pos.x = screen_width/2;
-    player_pos.y = screen_height/2;
-    
-    new_game->player_position              = player_pos;
-    new_game->player_velocity              = (Vector2){0.0f, 0.0f};
-    new_game->player_acceleration          = 0.0f;
-    new_game->player_rotation              = 0.0f;
-    new_game->player_rotational_velocity   = 0.0f;
-    new_game->asteroid_positions           = malloc(sizeof(Vector2)*max_asteroids);
-    new_game->asteroid_velocities          = malloc(sizeof(Vector2)*max_asteroids);
-    new_game->asteroid_rotation            = malloc(sizeof(float)*max_asteroids);
-    new_game->asteroid_rotational_velocity = malloc(sizeof(float)*max_asteroids);
-    new_game->asteroid_sizes               = malloc(sizeof(int)*max_asteroids);
-    new_game->asteroid_count               = 0;
-    new_game->max_asteroids                = max_asteroids;
-    new_game->particle_positions           = malloc(sizeof(Vector2)*max_particles);
-    new_game->max_particles                = max_particles;
-    new_game->particle_count               = 0;
-    new_game->particle_velocities          = malloc(sizeof(Vector2)*max_particles);
-    new_game->particle_time                = malloc(sizeof(float)*max_particles);
-    new_game->missile_positions            = malloc(sizeof(Vector2)*max_missiles);
-    new_game->missile_velocities           = malloc(sizeof(Vector2)*max_missiles);
-    new_game->missile_count                = 0;
-    new_game->max_missiles                 = max_missiles;
-    new_game->screen_height                = screen_height;
-    new_game->screen_width                 = screen_width;
-    new_game->lives                        = 3;
-    new_game->player_cooldown              = 0.0f;
-    new_game->invicibility_time            = 0.0f;
-    
-    return new_game;
-}
-
-void DeInitGame(GameData *game) {
-    free(game->asteroid_positions);
-    free(game->asteroid_velocities);
-    free(game->asteroid_rotation);
-    free(game->asteroid_rotational_velocity);
-    free(game->asteroid_sizes);
-    free(game->particle_positions);
-    free(game->particle_velocities);
-    free(game->particle_time);
-    free(game->missile_positions);
-    free(game->missile_velocities);
-    free(game);
-}
-
-bool OffScreen(Vector2 v, int screen_width, int screen_height) {
-    
-    if (v.x < 0) {
-        return true;
-    }
-    
-    if (v.y < 0) {
-        return true;
+void DrawProfile(int x, int y, const int *gauges) {
+    DrawText("phase                min    avg    p99 ms", x, y, 10, GREEN);
+    y += 12;
+    
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        ProfileStats stats = ProfileGetStats(p);
+        bool in_step = p > PROFILE_GAME_STEP && p <= PROFILE_SWEEP;
+        
+        DrawText(
+            TextFormat(
+                "%s%-18s %6.2f %6.2f %6.2f",
+                in_step ? "  " : "",
+                ProfilePhaseName(p),
+                stats.min_ms,
+                stats.average_ms,
+                stats.p99_ms
+            ),
+            x, y, 10, GREEN
+        );
+        y += 12;
     }
     
-    if (v.x > screen_width) {
-        return true; 
+    for (int g = 0; g < PROFILE_GAUGE_COUNT; g++) {
+        DrawText(TextFormat("%s %d", ProfileGaugeName(g), gauges[g]), x, y, 10, GREEN);
+        y += 12;
     }
     
-    if (v.y > screen_height) {
-        return true;
+    if (ProfileCsvOpen()) {
+        DrawText("writing profile.csv", x, y, 10, RED);
     }
-    
-    return false;
 }
+#endif
 
-void SpawnMissile(GameData *game, Vector2 position, float rotation, float acceleration, float delta_time) {
-    int index = ++game->missile_count-1;
-    
-    if (index >= game->max_missiles) {
-        //shift all missiles down by one
-        for (int i = 1; i < game->max_missiles; i++) {
-            game->missile_positions[i-1] = game->particle_positions[i];
-            game->missile_velocities[i-1] = game->missile_velocities[i];
-        }
-        
-        index = game->max_missiles-1;
-        game->missile_count = game->max_missiles;
-    }
-    
-    game->missile_positions[index] = position;
-    
-    game->missile_velocities[index] = UpdateVelocity(
-        (Vector2){0, 0},
-        acceleration,
-        rotation,
-        delta_time
-    );
-}
+//A copy of the game to draw from, with what else the frontend needs to draw it
+typedef struct FrameView {
+    GameData *game;
+    //how far between the last tick and the next one this frame is drawn
+    float alpha;
+    float previous_rotation;
+    //GameEvents of every tick since the last view
+    unsigned int events;
+    #ifdef PROFILE
+    //set by the ticks that made this view
+    int gauges[PROFILE_GAUGE_COUNT];
+    #endif
+} FrameView;
 
-void SpawnParticle(GameData *game, Vector2 position, Vector2 initial_velocity, float rotation, float acceleration, float delta_time) {
-    int index = ++game->particle_count-1;
-    
-    if (index >= game->max_particles) {
-        //shift all particles down an index
-        for (int i = 1; i < game->max_particles; i++) {
-            game->particle_positions[i-1] = game->particle_positions[i];
-            game->particle_velocities[i-1] = game->particle_velocities[i];
+/*
+    One frame's worth of ticks, run on the pipeline thread while the main
+    thread draws the last view. game belongs to that thread until
+    PipelineWait returns.
+*/
+typedef struct SimFrame {
+    GameData *game;
+    Replay *replay;
+    Recorder *recorder;
+    //keys held this frame, fire only goes to the first tick
+    Input input;
+    int ticks;
+    float tick_length;
+    //player rotation before the last tick, kept across frames
+    float previous_rotation;
+    //filled in with the state after the last tick
+    FrameView *view;
+    bool replay_finished;
+    bool recording_failed;
+} SimFrame;
+
+static void SimulateFrame(void *data) {
+    SimFrame *frame = data;
+    GameData *game = frame->game;
+    unsigned int events = 0;
+    
+    PROFILE_SCOPE(PROFILE_GAME_STEP) {
+        for (int t = 0; t < frame->ticks; t++) {
+            Input input = frame->input;
+            float delta_time = frame->tick_length;
+            input.fire = input.fire && t == 0;
+            
+            //a replay brings its own input and delta_time
+            if (frame->replay && !ReplayTick(frame->replay, game, &input, &delta_time)) {
+                frame->replay_finished = true;
+                break;
+            }
+            
+            frame->previous_rotation = game->player_rotation;
+            GameStep(game, &input, delta_time);
+            events |= game->events;
+            
+            if (frame->recorder && !RecordTick(frame->recorder, &input, delta_time, game)) {
+                frame->recording_failed = true;
+            }
         }
-        
-        index = game->max_particles-1;
-        game->particle_count = game->max_particles;
     }
     
-    game->particle_positions[index] = position;
+    CopyGameState(frame->view->game, game);
+    frame->view->previous_rotation = frame->previous_rotation;
+    frame->view->events = events;
     
-    game->particle_velocities[index] = UpdateVelocity(
-        initial_velocity,
-        acceleration,
-        rotation,
-        delta_time
-    );
-}
-
-void SpawnAsteroid(GameData *game, int size, Vector2 position, float rotation, float acceleration, float delta_time) {
-    if (game->asteroid_count <= game->max_asteroids) {
-        int index = ++game->asteroid_count-1;
-        game->asteroid_positions[index] = position;
-        game->asteroid_rotation[index] = rotation;
-        game->asteroid_sizes[index] = size;
-        game->asteroid_velocities[index] = UpdateVelocity(
-            (Vector2){0, 0},
-            acceleration,
-            rotation,
-            delta_time
-        );
-        game->asteroid_rotational_velocity[index] = GetRandomValue(-90*size, 90*size);
+    #ifdef PROFILE
+    for (int g = 0; g < PROFILE_GAUGE_COUNT; g++) {
+        frame->view->gauges[g] = ProfileGetGauge(g);
     }
+    #endif
 }
 
-void DestroyAsteroid(GameData *game, int index, float delta_time) {
-    int asteroid_size = game->asteroid_sizes[index];
-    Vector2 pos = game->asteroid_positions[index];
-    Vector2 velocity = Vector2Scale(game->asteroid_velocities[index], 0.5);
-    
-    //shift asteroid array down which removes asteroid
-    for (int i = index; i < game->asteroid_count; i++) {
-        game->asteroid_positions[i] = game->asteroid_positions[i+1];
-        game->asteroid_velocities[i] = game->asteroid_velocities[i+1];
-        game->asteroid_rotation[i] = game->asteroid_rotation[i+1];
-        game->asteroid_rotational_velocity[i] = game->asteroid_rotational_velocity[i+1];
-        game->asteroid_sizes[i] = game->asteroid_sizes[i+1];
-    }
-    
-    game->asteroid_count--;
-    
-    int angle = GetRandomValue(0, 360);
-    
-    //Spawn particles 
-    int p = 100/asteroid_size;
-    for (int i = 0; i < p; i++) {
-        SpawnParticle(
-            game,
-            pos,
-            velocity,
-            GetRandomValue(-22*asteroid_size, 22*asteroid_size)+angle,
-            GetRandomValue(10, 500/asteroid_size),
-            delta_time
-        );
+/*
+    asteroids1 [--record file] [--replay file] [--uncapped] [--analytic] [--asteroids n] [--world WxH] [--target-ms ms] [--serial]
+
+    --record saves every tick's input to file, --replay plays one back
+    instead of reading the keyboard and reports whether it matched.
+    --uncapped lifts the frame cap, for timing a replay.
+    --analytic starts with analytic particles, see ParticleMode.
+    --asteroids sets the asteroid pool size, waves are a third of it.
+    --world makes the world W by H pixels, the screen follows the ship.
+    --target-ms is the frame time the quality governor aims for, 0 turns
+    it off. Defaults to a 144 Hz frame with some room for the driver.
+    --serial simulates and draws one after the other instead of at once.
+*/
+int main(int argc, char **argv) {
+    const char *record_path = NULL;
+    const char *replay_path = NULL;
+    bool uncapped = false;
+    bool analytic = false;
+    int max_asteroids = 20;
+    int world_width = 800;
+    int world_height = 600;
+    float target_ms = 6.9f;
+    bool serial = false;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i+1 < argc) {
+            record_path = argv[++i];
+        }
         
-       
-    }
-    
-    //Spawn new asteroids if not the smallest asteroid size
-    if (asteroid_size < 4) {
-        for (int i = 0; i < 2; i++) {
-            SpawnAsteroid(
-                game,
-                asteroid_size+2,
-                pos,
-                GetRandomValue(0, 360),
-                GetRandomValue(30, 100)*asteroid_size,
-                delta_time
-                
-            );
+        else if (strcmp(argv[i], "--replay") == 0 && i+1 < argc) {
+            replay_path = argv[++i];
         }
-    }
-}
-
-void KillOffscreenParticles(GameData *game) {
-    int index = 0;
-    
-    while (index < game->particle_count) {
-        //check if on screen
-        Vector2 p = game->particle_positions[index];
-        bool offscreen = OffScreen(p, game->screen_width, game->screen_height);
         
-        //Also kill if too old
-        if (game->particle_time[index] > 3.0f) {
+        else if (strcmp(argv[i], "--uncapped") == 0) {
+            uncapped = true;
+        }
+        
+        else if (strcmp(argv[i], "--analytic") == 0) {
+            analytic = true;
+        }
+        
+        else if (strcmp(argv[i], "--asteroids") == 0 && i+1 < argc) {
+            max_asteroids = atoi(argv[++i]);
             
-            if (GetRandomValue(0, 1000) < 10) {
-                offscreen = true;
+            if (max_asteroids < 0 || max_asteroids > REPLAY_MAX_ENTITIES) {
+                printf("--asteroids takes 0 to %d\n", REPLAY_MAX_ENTITIES);
+                return 1;
             }
         }
         
-        if (offscreen) {
-            //shift particles over and shorten particle list
-            for (int i = index; i < game->particle_count; i++) {
-                game->particle_positions[i] = game->particle_positions[i+1];
-                game->particle_velocities[i] = game->particle_velocities[i+1];
-                game->particle_time[i] = game->particle_time[i+1];
-            }
+        else if (strcmp(argv[i], "--world") == 0 && i+1 < argc) {
             
-            game->particle_count--;
+            //no smaller than the 800x600 screen, so recordings of it can be played back
+            bool valid = sscanf(argv[++i], "%dx%d", &world_width, &world_height) == 2
+                && world_width >= 800 && world_height >= 600
+                && world_width <= REPLAY_MAX_WORLD_SIZE && world_height <= REPLAY_MAX_WORLD_SIZE;
+            
+            if (!valid) {
+                printf("--world takes a size like 8000x6000, at least 800x600\n");
+                return 1;
+            }
         }
         
-        else {
-            index++;
+        else if (strcmp(argv[i], "--target-ms") == 0 && i+1 < argc) {
+            target_ms = (float)atof(argv[++i]);
         }
-    }
-}
-
-void KillOffscreenMissiles(GameData *game) {
-    int index = 0;
-    
-    while (index < game->missile_count) {
-        Vector2 m = game->missile_positions[index];
-        bool offscreen = OffScreen(m, game->screen_width, game->screen_height);
-        
-        if (offscreen) {
-            //shift missiles over and shorten missile list 
-            for (int i = index; i < game->missile_count; i ++) {
-                game->missile_positions[i] = game->missile_positions[i+1];
-                game->missile_velocities[i] = game->missile_velocities[i+1];
-            }
-            
-            game->missile_count--;
+        
+        else if (strcmp(argv[i], "--serial") == 0) {
+            serial = true;
         }
         
         else {
-            index++;
+            printf("usage: %s [--record file] [--replay file] [--uncapped] [--analytic] [--asteroids n] [--world WxH] [--target-ms ms] [--serial]\n", argv[0]);
+            return 1;
         }
     }
-}
-
-bool CheckMissileCollisions(GameData *game, float delta_time) {
-    int asteroid_radius = 50;
-    int missile_radius = 8;
-    bool missile_collision = false;
-    
-    for (int i = 0; i < game->missile_count; i++) {
-        for (int j = 0; j < game->asteroid_count; j++) {
-            
-            Vector2 missile_pos = game->missile_positions[i];
-            Vector2 aster_pos = game->asteroid_positions[j];
-            int asteroid_size = game->asteroid_sizes[j];
-            
-            if (CheckCollisionCircles(missile_pos, missile_radius, aster_pos, asteroid_radius/asteroid_size)) {
-                game->missile_positions[i] = (Vector2){-1000, -1000};
-                DestroyAsteroid(game, j, delta_time);
-                missile_collision = true;
-            }
+    
+    ReplayHeader setup = {
+        .seed          = (unsigned int)time(NULL),
+        .screen_width  = 800,
+        .screen_height = 600,
+        .max_asteroids = max_asteroids,
+        .max_particles = 1000000,
+        .max_missiles  = 10,
+        .particle_mode = analytic ? PARTICLES_ANALYTIC : PARTICLES_INTEGRATED,
+        .world_width   = world_width,
+        .world_height  = world_height
+    };
+    
+    Replay *replay = NULL;
+    Recorder *recorder = NULL;
+    
+    if (replay_path) {
+        replay = OpenReplay(replay_path, &setup);
+        
+        if (replay == NULL) {
+            printf("%s is not a recording\n", replay_path);
+            return 1;
         }
     }
     
-    return missile_collision;
-}
-
-bool CheckPlayerCollision(GameData *game, float delta_time, Vector2 *player_graphic, int ship_l, Vector2 *asteroid_graphic, int asteroid_l) {
-    Vector2 player_pos = game->player_position;
-    
-    Vector2 translated_ship[ship_l];
-    float to_radians = 0.01745f;
+    const int screen_height = setup.screen_height;
+    const int screen_width = setup.screen_width;
+    int max_particles = setup.max_particles;
     
-    //translate ship point coordinates
-    for (int i = 0; i < ship_l; i++) {
-        translated_ship[i] = player_graphic[i];
-        translated_ship[i] = Vector2Rotate(translated_ship[i], game->player_rotation*to_radians);
-        translated_ship[i] = Vector2Add(translated_ship[i], game->player_position);
+    //The simulation runs at TICK_RATE whatever the frame rate, so draw as often as the display refreshes
+    if (!uncapped) {
+        SetConfigFlags(FLAG_VSYNC_HINT);
     }
     
-    for (int i = 0; i < game->asteroid_count; i++) {
-        
-        Vector2 asteroid_pos = game->asteroid_positions[i];
-        float asteroid_rotation = game->asteroid_rotation[i];
-        int asteroid_size = game->asteroid_sizes[i];
-        
-        Vector2 translated_asteroid_graphic[asteroid_l];
-        
-        //translate asteroid point coordinates
-        for(int j = 0; j < asteroid_l; j++) {
-            translated_asteroid_graphic[j] = asteroid_graphic[j];
-            translated_asteroid_graphic[j] = Vector2Scale(translated_asteroid_graphic[j], 1/(float)asteroid_size);
-            translated_asteroid_graphic[j] = Vector2Rotate(translated_asteroid_graphic[j], asteroid_rotation);
-            translated_asteroid_graphic[j] = Vector2Add(translated_asteroid_graphic[j], asteroid_pos);
-        }
-        
-        
-        //Check collision of points in players ship against asteroid polygon
-        for (int j = 0; j < ship_l; j++) {
-            bool collided = CheckCollisionPointPoly(translated_ship[j], translated_asteroid_graphic, asteroid_l);
-            
-            if (collided) {
-                printf("Destroyed asteroid index: %d, number of asteroids: %d\n", i, game->asteroid_count);
-                DestroyAsteroid(game, i, delta_time);
-                return true;
-            }
-        }
-        
+    InitWindow(screen_width, screen_height, "Asteroids");
+    int target_fps = 144;
+    
+    GameData *game = InitNewGame(screen_height, screen_width, setup.max_asteroids, max_particles, setup.max_missiles, setup.seed);
+    
+    if (game == NULL || !SetWorldSize(game, setup.world_width, setup.world_height)) {
+        printf("out of memory for %d asteroids in a %dx%d world\n", setup.max_asteroids, setup.world_width, setup.world_height);
+        CloseWindow();
+        return 1;
     }
     
-    return false;
-}
-
-//Prepares a list for drawing vector graphic
-Vector2* RenderTranslation(Vector2 *array, int array_length, float rotation, Vector2 position, float scale) {
-    Vector2 *translated = malloc(sizeof(Vector2)*array_length);
-    /*Multiply the rotation angle by to_radians to convert angle in to radians to
-      be used by Vector2 manipulation functions
+    game->jobs = CreateJobSystem(DefaultWorkerCount());
+    SetParticleMode(game, setup.particle_mode, 1.0f/TICK_RATE);
+    
+    /*
+        Frames are drawn from views, copies of game made after each frame's
+        ticks. While one is drawn the next frame's ticks run into the other,
+        so the picture is a frame behind the simulation. Drawing gets its
+        own job system, the simulation's is busy meanwhile.
     */
-    float to_radians = 0.01745f;
+    JobSystem *render_jobs = CreateJobSystem(DefaultWorkerCount()/2);
+    FrameView views[2] = {0};
+    int front = 0;
     
-    for (int i = 0; i < array_length; i++) {
-        //Load coordinates in to translation array 
-        translated[i] = array[i];
-        //fix coordinates from bottem left origin to top left origin 
-        translated[i].y *= -1.0f;
-        //Rotate
-        translated[i] = Vector2Rotate(translated[i], rotation*to_radians);
-        //Scale
-        translated[i] = Vector2Scale(translated[i], scale);
-        //Translate
-        translated[i] = Vector2Add(position, translated[i]);
+    for (int v = 0; v < 2; v++) {
+        views[v].game = InitNewGame(screen_height, screen_width, setup.max_asteroids, max_particles, setup.max_missiles, setup.seed);
+        
+        if (views[v].game == NULL || !SetWorldSize(views[v].game, setup.world_width, setup.world_height)) {
+            printf("out of memory for a second copy of the game to draw from\n");
+            CloseWindow();
+            return 1;
+        }
+        
+        views[v].game->jobs = render_jobs;
     }
     
-    return translated;
-}
-
-
-int main(void) {
-    const int screen_height = 600;
-    const int screen_width = 800;
-    int max_asteroids = 20;
-    int max_particles = 1000000;
-    int max_missiles = 10;
-    Vector2 background_speed = {10, 30};
-    float background_rotation = 0.0f;
-    
-    GameData *game = InitNewGame(screen_height, screen_width, max_asteroids, max_particles, max_missiles);
-    
-    Vector2 ship_graphic[] = {
-        {0.0f, 12.0f},
-        {10.0f, -10.0f},
-        {0.0f, -5.0f},
-        {-10.0f, -10.0f},
-        {0.0f, 12.0f}
-    };
+    CopyGameState(views[front].game, game);
+    views[front].alpha = 1.0f;
+    views[front].previous_rotation = game->player_rotation;
+    views[front].events = 0;
     
-    Vector2 asteroid_graphic[9] = {
-        {0, 50},
-        {0, 55},
-        {0, 40},
-        {0, 55},
-        {0, 30},
-        {0, 45},
-        {0, 55},
-        {0, 45},
-        {0, 50}
-    };
+    Pipeline *pipeline = CreatePipeline(!serial);
     
-    int asteroid_graphic_length = 9;
+    if (pipeline == NULL) {
+        printf("out of memory for the simulation pipeline\n");
+        CloseWindow();
+        return 1;
+    }
     
-    for (int i = 0; i < asteroid_graphic_length; i++) {
-        asteroid_graphic[i] = Vector2Rotate(asteroid_graphic[i], (45*i)*0.017453);
+    if (record_path) {
+        recorder = StartRecording(record_path, &setup);
+        
+        if (recorder == NULL) {
+            printf("could not record to %s\n", record_path);
+        }
     }
     
-
+    double replay_start = GetTime();
     
     Vector2 flame_graphic[] = {{4, -7}, {0, -20}, {-4, -7}};
     
-    int ship_graphic_length = 5;
+    int ship_graphic_length = SHIP_GRAPHIC_LENGTH;
     int flame_graphic_length = 3;
     
     unsigned char flame_toggle = 0;
-    bool render_flame = false;
-    int thrust_time = 0;
-    bool nuke = false;
-    float nuke_radius = 0.0;
     
-    InitWindow(screen_width, screen_height, "Asteroids");
-    int target_fps = 144;
-    SetTargetFPS(target_fps);
+    FrameArena frame_arena;
+    ArenaInit(&frame_arena, FRAME_ARENA_SIZE);
     
     //Load sounds
     InitAudioDevice();
@@ -502,269 +383,231 @@ int main(void) {
     
     Shader fade = LoadShader(0, "fade.fs");
     
+    Starfield starfield;
+    LoadStarfield(&starfield, screen_width, screen_height, setup.seed);
+    
+    //F2 switches back to one DrawLineV per particle to compare frame times
+    ParticleBatch particle_batch;
+    bool batch_particles = LoadParticleBatch(&particle_batch, max_particles);
+    bool batch_loaded = batch_particles;
+    //F6 does the same for asteroids, between the sprite atlas and line strips
+    AsteroidAtlas asteroid_atlas;
+    bool atlas_asteroids = LoadAsteroidAtlas(&asteroid_atlas, game);
+    bool atlas_loaded = atlas_asteroids;
+    int stress_level = 0;
+    Rng stress_rng;
+    RngSeedStream(&stress_rng, setup.seed, RNG_STREAM_FRONTEND);
+    float average_frame_ms = 0.0f;
+    
+    //F7 keeps the game as it is and writes it to SAVE_STATE_PATH, F8 goes back to it
+    Snapshot save_state = {0};
+    
+    //Particle emission changes what GameStep does, so recordings stay at full quality
+    Governor governor;
+    InitGovernor(&governor, target_ms);
+    governor.held = replay || recorder;
+    const QualityLevel *quality = GovernorQuality(&governor);
+    
+    #ifdef PROFILE
+    //F1 shows the profiler breakdown, F4 starts and stops profile.csv
+    bool show_profile = true;
+    #endif
+    
+    //Fixed rate simulation, frames are drawn between the last two ticks
+    const float tick_length = 1.0f/TICK_RATE;
+    float accumulator = 0.0f;
+    bool fire_pressed = false;
+    
+    SimFrame sim = {
+        .game              = game,
+        .tick_length       = tick_length,
+        .previous_rotation = game->player_rotation
+    };
+    
     
     //Main Loop
     while (!WindowShouldClose()) {
+        PROFILE_BEGIN_FRAME();
+        RenderBeginFrame();
+        double frame_start = GetTime();
         /*
             Update
         */
-        float delta_time = GetFrameTime();
+        PROFILE_BEGIN(PROFILE_INPUT);
+        float frame_time = GetFrameTime();
         flame_toggle++;
         
-        //Spawn asteroids if none
-        if (game->asteroid_count == 0) {
-            
-            int asteroids_to_spawn = game->max_asteroids/3;
-            
-            while (asteroids_to_spawn > 0) {
-                //find a location greater than 70 pixels from player 
-                Vector2 apos = {
-                    GetRandomValue(0, game->screen_width), 
-                    GetRandomValue(0, game->screen_height)
-                };
-                
-                float distance = Vector2Distance(game->player_position, apos);
-                
-                if (distance < 70) {
-                    continue;
-                }
-                
-                SpawnAsteroid(
-                    game,
-                    1,
-                    apos,
-                    GetRandomValue(0, 360),
-                    1,
-                    0.16
-                );
-                
-                asteroids_to_spawn--;
-            }
-            
+        //A fire press is kept until a tick uses it
+        fire_pressed |= IsKeyPressed(KEY_SPACE);
+        
+        if (IsKeyPressed(KEY_F2) && batch_loaded) {
+            batch_particles = !batch_particles;
         }
         
-        //Get player input
-        if (game->player_cooldown == 0) {
+        if (IsKeyPressed(KEY_F6) && atlas_loaded) {
+            atlas_asteroids = !atlas_asteroids;
+        }
         
-            if (IsKeyDown(KEY_RIGHT)) {
-                game->player_rotation = UpdateRotation(game->player_rotation, 360, delta_time);
-            }
-            
-            if (IsKeyDown(KEY_LEFT)) {
-                game->player_rotation = UpdateRotation(game->player_rotation, -360, delta_time);
-            }
-            
-            if (IsKeyPressed(KEY_SPACE)) {
-                
-                SpawnMissile(
-                    game,
-                    game->player_position,
-                    game->player_rotation,
-                    game->player_acceleration+500,
-                    delta_time
-                );
-                
-                PlaySound(gun);
+        //Stress particles aren't spawned by GameStep, so a recording can't hold them
+        if (IsKeyPressed(KEY_F3) && !replay && !recorder) {
+            stress_level = (stress_level+1)%STRESS_LEVEL_COUNT;
+        }
+        
+        //F5 switches between integrated and analytic particles, a recording holds one mode
+        if (IsKeyPressed(KEY_F5) && !replay && !recorder) {
+            ParticleMode mode = game->particle_mode == PARTICLES_ANALYTIC ? PARTICLES_INTEGRATED : PARTICLES_ANALYTIC;
+            SetParticleMode(game, mode, 1.0f/TICK_RATE);
+        }
+        
+        //Going back in time would break a recording too
+        if (IsKeyPressed(KEY_F7) && !replay && !recorder) {
+            if (TakeSnapshot(&save_state, game) && SaveSnapshot(&save_state, SAVE_STATE_PATH)) {
+                printf("save state: tick %llu written to %s\n", game->tick, SAVE_STATE_PATH);
             }
             
-            if (IsKeyDown(KEY_UP)) {
-                
-                game->player_acceleration = 1.0f;
-                render_flame = true;
-                thrust_time += 4;
-                
-                if (!IsSoundPlaying(thrust)) {
-                    PlaySound(thrust);
-                }
+            else {
+                printf("save state: could not write %s\n", SAVE_STATE_PATH);
             }
-            
         }
         
-        if (IsKeyUp(KEY_UP)||game->player_cooldown > 0) {
-            game->player_acceleration = 0.0f;
-            render_flame = false;
-            thrust_time = 0;
+        if (IsKeyPressed(KEY_F8) && !replay && !recorder) {
+            //one left by an earlier run is mapped in, not read
+            if (save_state.data == NULL) {
+                LoadSnapshot(&save_state, SAVE_STATE_PATH, true);
+            }
             
-            if (IsSoundPlaying(thrust)) {
-                StopSound(thrust);
+            if (!RestoreSnapshot(game, &save_state)) {
+                printf("save state: nothing saved for this world and these pool sizes\n");
             }
         }
         
-        //Update Player
-        
-        game->invicibility_time -= delta_time;
-        game->player_cooldown -= delta_time;
+        //Slow drifting particles so the count holds steady while measuring
+        Vector2 view_origin = ViewOrigin(game);
         
-        if (game->invicibility_time < 0.0f) {
-            game->invicibility_time = 0.0f;
-        }
-        
-        if (game->player_cooldown < 0.0f) {
-            game->player_cooldown = 0.0f;
+        for (int i = game->particles.count; i < stress_levels[stress_level]; i++) {
+            Vector2 position = {
+                view_origin.x + RngFloat(&stress_rng, 0, screen_width),
+                view_origin.y + RngFloat(&stress_rng, 0, screen_height)
+            };
+            Vector2 velocity = {RngFloat(&stress_rng, -0.1f, 0.1f), RngFloat(&stress_rng, -0.1f, 0.1f)};
+            SpawnParticle(game, position, velocity, 0, 0, 0);
         }
         
-        bool check_player_collision = true;
-        //Check player collision and kill player if hit asteroid
-        if (game->invicibility_time > 0.0f||game->player_cooldown > 0.0f) {
-            check_player_collision = false;
+        #ifdef PROFILE
+        if (IsKeyPressed(KEY_F1)) {
+            show_profile = !show_profile;
         }
         
-        
-        if (check_player_collision) {
-            bool player_collided = CheckPlayerCollision(
-                game, 
-                delta_time,     
-                ship_graphic,
-                sizeof(ship_graphic)/sizeof(ship_graphic[0]),
-                asteroid_graphic,
-                sizeof(asteroid_graphic)/sizeof(asteroid_graphic[0])
-                );
+        if (IsKeyPressed(KEY_F4)) {
+            if (ProfileCsvOpen()) {
+                ProfileCloseCsv();
+            }
             
-            if (player_collided) {
-                Vector2 player_v = game->player_velocity;
-                game->player_cooldown = 3.0f;
-                game->invicibility_time = 6.0f;
-                game->lives--;
-                game->player_velocity = (Vector2){0, 0};
-                
-                
-                //spawn particles 
-                int player_explosion_particles = 900;
-                nuke = true;
-                
-                for (int i =0; i < player_explosion_particles; i++) {
-                    //set particle speed; super particle speed for looks
-                    int super_particle = GetRandomValue(0, 1000);
-                    int particle_speed;
-                    if (super_particle < 500) {
-                        particle_speed = 300;
-                    }
-                    else {
-                        particle_speed = GetRandomValue(1, 100);
-                    }
-                    SpawnParticle(
-                        game,
-                        game->player_position,
-                        (Vector2){0, 0},
-                        GetRandomValue(0, 360),
-                        particle_speed,
-                        delta_time
-                    );
-                }
-                
-                PlaySound(player_explosion);
+            else if (!ProfileOpenCsv("profile.csv")) {
+                printf("profiler: could not open profile.csv\n");
             }
         }
+        #endif
+        PROFILE_END(PROFILE_INPUT);
         
-        game->player_velocity = UpdateVelocity(
-            game->player_velocity,
-            game->player_acceleration,
-            game->player_rotation,
-            delta_time
-        );
-        
-        game->player_position = UpdatePosition(
-            game->player_position,
-            game->player_velocity,
-            game->screen_width,
-            game->screen_height,
-            true
-        );
+        //Run however many fixed ticks fit in the time since the last frame
+        accumulator += frame_time;
         
-        //Update Asteroids 
-        for (int i = 0; i < game->asteroid_count; i++) {
-            game->asteroid_rotation[i] = UpdateRotation(
-                game->asteroid_rotation[i],
-                game->asteroid_rotational_velocity[i],
-                delta_time
-            );
-            
-            game->asteroid_positions[i] = UpdatePosition(
-                game->asteroid_positions[i],
-                game->asteroid_velocities[i],
-                game->screen_width,
-                game->screen_height,
-                true
-            );
+        if (replay && uncapped) {
+            //as fast as frames can be drawn
+            accumulator = tick_length;
         }
         
-        //Update Particles 
-        for (int i = 0; i < game->particle_count; i++) {
-            
-            game->particle_positions[i] = UpdatePosition(
-                game->particle_positions[i],
-                game->particle_velocities[i],
-                game->screen_width,
-                game->screen_height,
-                false
-            );
-            game->particle_time[i] += delta_time;
-        }
+        int ticks = (int)(accumulator/tick_length);
+        accumulator -= ticks*tick_length;
         
-        //Update Missiles
-        for (int i =0; i < game->missile_count; i++) {
-            game->missile_positions[i] = UpdatePosition(
-                game->missile_positions[i],
-                game->missile_velocities[i],
-                game->screen_width,
-                game->screen_height,
-                false
-            );
+        //Too slow to keep up, drop the backlog instead of spiralling
+        if (ticks >= MAX_TICKS_PER_FRAME) {
+            ticks = MAX_TICKS_PER_FRAME;
+            accumulator = 0.0f;
         }
         
+        //Held keys are sampled once a frame, a press is kept until a tick uses it
+        sim.input = (Input){
+            .rotate_left  = IsKeyDown(KEY_LEFT),
+            .rotate_right = IsKeyDown(KEY_RIGHT),
+            .thrust       = IsKeyDown(KEY_UP),
+            .fire         = fire_pressed
+        };
+        
+        if (ticks > 0) {
+            fire_pressed = false;
+        }
         
-        KillOffscreenParticles(game);
-        KillOffscreenMissiles(game);
-        bool asteroid_explosion = CheckMissileCollisions(game, delta_time);
+        sim.replay = replay;
+        sim.recorder = recorder;
+        sim.ticks = ticks;
+        sim.view = &views[1-front];
+        sim.view->alpha = accumulator/tick_length;
+        PipelineSubmit(pipeline, SimulateFrame, &sim);
+        
+        //Everything below draws the last view and leaves game alone
+        FrameView *view = &views[front];
+        GameData *shown = view->game;
+        float alpha = view->alpha;
+        
+        //Sounds
+        PROFILE_BEGIN(PROFILE_SOUND);
+        if (view->events & GAME_EVENT_MISSILE_FIRED) {
+            PlaySound(gun);
+        }
         
-        if (asteroid_explosion) {
+        if (view->events & GAME_EVENT_ASTEROID_EXPLODED) {
             PlaySound(explosion);
         }
         
-        //Background
-        background_rotation = UpdateRotation(background_rotation, 5.0f, delta_time);
-        if (flame_toggle%1 == 0) {
-            
-            Vector2 particle_pos = {
-                GetRandomValue(0, screen_width),
-                GetRandomValue(0, screen_height)
-            };
+        if (view->events & GAME_EVENT_PLAYER_EXPLODED) {
+            PlaySound(player_explosion);
+        }
+        
+        if (shown->thrusting) {
             
-            SpawnParticle(
-                game,
-                particle_pos,
-                (Vector2){0, 0},
-                background_rotation+180,
-                GetRandomValue(background_speed.x, background_speed.y),
-                delta_time
-            );
-
+            if (!IsSoundPlaying(thrust)) {
+                PlaySound(thrust);
+            }
         }
         
+        else if (IsSoundPlaying(thrust)) {
+            StopSound(thrust);
+        }
+        PROFILE_END(PROFILE_SOUND);
         
         
         //Draw 
+        PROFILE_BEGIN(PROFILE_DRAW_WORLD);
+        ArenaReset(&frame_arena);
         BeginTextureMode(target);
         //BeginShaderMode(fade);
             
             ClearBackground(BLACK);
             
-            //Translate coordinates for screen drawing 
-            Vector2 *player_graphic_translation = RenderTranslation(
-                ship_graphic,
-                ship_graphic_length,
-                game->player_rotation,
-                game->player_position,
-                1
-            );
-     
+            //Where the ship was alpha of the way through the next tick
+            Vector2 ship_position = RenderPosition(shown->player_position, shown->player_velocity, alpha);
+            float ship_rotation = LerpAngle(view->previous_rotation, shown->player_rotation, alpha);
+            
+            //Follows the drawn ship, so it stays smooth between ticks
+            Camera2D camera = {
+                .offset = {screen_width/2.0f, screen_height/2.0f},
+                .target = CameraTarget(shown, ship_position),
+                .zoom   = 1.0f
+            };
+            
+            UpdateStarfield(&starfield, shown, frame_time);
+            DrawStarfield(&starfield, quality->star_layers, Vec2Subtract(camera.target, camera.offset));
+            
+            BeginMode2D(camera);
             
             //Draw player ship (flashing if invincible)
             
             bool draw_ship = false;
             
             
-            if (game->invicibility_time == 0.0f) {
+            if (shown->invicibility_time == 0.0f) {
                 draw_ship = true;
             }
             
@@ -780,94 +623,92 @@ int main(void) {
                 }
             }
             
-            if (game->player_cooldown > 0.0f) {
+            if (shown->player_cooldown > 0.0f) {
                 draw_ship = false;
                 
             }
             
             if (draw_ship) {
-                DrawLineStrip(player_graphic_translation, ship_graphic_length, WHITE);
+                Vector2 *ship = ArenaAlloc(&frame_arena, sizeof(Vector2)*ship_graphic_length);
+                PlaceShape(shown->shapes->ship[ShapeAngle(ship_rotation)], ship_graphic_length, ship_position, ship);
+                RenderLineStrip(ship, ship_graphic_length, WHITE);
             }
             
-            //Draw player thrust flame and spawn particles
-            if (render_flame) {
+            //Draw player thrust flame
+            if (shown->thrusting) {
                 if (flame_toggle%(target_fps/6) == 0) {
                     
                     //fix position and rotation
                     Vector2 *fg = RenderTranslation(
+                        &frame_arena,
                         flame_graphic,
                         flame_graphic_length,
-                        game->player_rotation,
-                        game->player_position,
+                        ship_rotation,
+                        ship_position,
                         1
                     );
                     
-                    DrawLineStrip(fg, flame_graphic_length, WHITE);
-                    
+                    RenderLineStrip(fg, flame_graphic_length, WHITE);
+                }
+            }
+            
+            //Draw Asteroids
+            double asteroid_draw_start = GetTime();
+            
+            if (atlas_asteroids) {
+                //only the active chunks, the GPU clips what is left off screen
+                for (int r = 0; r < ActiveRunCount(shown); r++) {
+                    int start;
+                    int length = ActiveRun(shown, r, &start);
                     
-                    free(fg);
+                    for (int i = start; i < start+length; i++) {
+                        Vector2 position = RenderPosition(
+                            (Vector2){shown->asteroid_x[i], shown->asteroid_y[i]},
+                            (Vector2){shown->asteroid_vx[i], shown->asteroid_vy[i]},
+                            alpha
+                        );
+                        
+                        DrawAsteroidSprite(&asteroid_atlas, shown->asteroid_sizes[i], shown->asteroid_rotation[i], position, WHITE);
+                    }
                 }
-                //spawn particle
-                
-                Vector2 flame_point = player_graphic_translation[2];
                 
-                
-                SpawnParticle(
-                    game,
-                    flame_point,
-                    (Vector2){0, 0},
-                    game->player_rotation+180+GetRandomValue(-10, 10),
-                    game->player_acceleration+100.0f+GetRandomValue(0, thrust_time),
-                    delta_time
-                );
+                //flush so the time covers the GPU submit, like the particle batch
+                rlDrawRenderBatchActive();
             }
             
-            //Draw Asteroids 
-            for (int i = 0; i < game->asteroid_count; i++) {
-                Vector2 *translated_asteroid_graphic = RenderTranslation(
-                    asteroid_graphic,
-                    asteroid_graphic_length,
-                    game->asteroid_rotation[i],
-                    game->asteroid_positions[i],
-                    1/(float)game->asteroid_sizes[i]
-                );
-
-                
-                DrawLineStrip(translated_asteroid_graphic, asteroid_graphic_length, WHITE);
-                free(translated_asteroid_graphic);
-                
+            else {
+                DrawAsteroidOutlines(shown, alpha, WHITE);
+                rlDrawRenderBatchActive();
             }
             
+            float asteroid_draw_ms = (float)(GetTime()-asteroid_draw_start)*1000.0f;
+            
+            PROFILE_END(PROFILE_DRAW_WORLD);
+            
             //Draw Particles
-            for (int i = 0; i < game->particle_count; i++) {
-                Vector2 particle_start = game->particle_positions[i];
-                float time = game->particle_time[i];
-                
-                if (time > 0.9f) {
-                    time = 0.9f;
-                }
-                
-                Vector2 particle_end = UpdatePosition(
-                    particle_start,
-                    Vector2Scale(game->particle_velocities[i], 8*(1-time)),
-                    game->screen_width,
-                    game->screen_height,
-                    false
-                );
-                
-                
-                DrawLineV(particle_start, particle_end, WHITE);
+            PROFILE_BEGIN(PROFILE_DRAW_PARTICLES);
+            double particle_draw_start = GetTime();
+            
+            if (batch_particles) {
+                DrawParticleBatch(&particle_batch, shown, alpha, quality->particle_trail, WHITE);
             }
             
-            //Draw Missiles 
-            for (int i = 0; i < game->missile_count; i++) {
-                DrawCircleV(game->missile_positions[i], 1.0f, WHITE);
+            else {
+                DrawParticleLines(shown, alpha, quality->particle_trail, WHITE);
             }
-            //Release memory of translated coordinates 
-            free(player_graphic_translation);
+            
+            float particle_draw_ms = (float)(GetTime()-particle_draw_start)*1000.0f;
+            PROFILE_END(PROFILE_DRAW_PARTICLES);
+            
+            PROFILE_BEGIN(PROFILE_DRAW_WORLD);
+            //Draw Missiles 
+            DrawMissiles(shown, alpha, WHITE);
+            
+            EndMode2D();
          
          //EndShaderMode();
          EndTextureMode();
+         PROFILE_END(PROFILE_DRAW_WORLD);
          
          BeginDrawing();
             
@@ -882,13 +723,144 @@ int main(void) {
             
             DrawFPS(10, 10);
             
+            //Exponential average so the numbers are readable
+            average_frame_ms += (frame_time*1000.0f-average_frame_ms)*0.05f;
+            
+            DrawText(
+                TextFormat(
+                    "%d %s particles, %s: frame %.2f ms, submit %.2f ms",
+                    shown->particles.count,
+                    shown->particle_mode == PARTICLES_ANALYTIC ? "analytic" : "integrated",
+                    batch_particles ? "batched" : "DrawLineV",
+                    average_frame_ms,
+                    particle_draw_ms
+                ),
+                10, 35, 10, GREEN
+            );
+            
+            DrawText(
+                TextFormat(
+                    "%d asteroids, %d active, %s: submit %.2f ms, quality %s",
+                    shown->asteroids.count,
+                    ActiveAsteroidCount(shown),
+                    atlas_asteroids ? "atlas" : "DrawLineStrip",
+                    asteroid_draw_ms,
+                    quality->name
+                ),
+                10, 47, 10, GREEN
+            );
+            
+            //only what goes through render.h, the batch, atlas and stars are a few draws each
+            RenderStats render_stats = RenderGetStats();
+            //the view's pools, which hold what the simulation's do
+            PoolMemory pool_memory = GameMemory(shown);
+            
+            DrawText(
+                TextFormat(
+                    "%d draws, %lld vertices, pools %.1f MB committed of %.0f MB",
+                    render_stats.draws,
+                    render_stats.vertices,
+                    pool_memory.committed/1048576.0,
+                    pool_memory.reserved/1048576.0
+                ),
+                10, 59, 10, GREEN
+            );
             
+            //this frame's work, EndDrawing may wait for vsync
+            double draw_end = GetTime();
+            
+            #ifdef PROFILE
+            if (show_profile) {
+                DrawProfile(10, 74, view->gauges);
+            }
+            #endif
             
+            
+            
+        
+        PROFILE_SCOPE(PROFILE_PRESENT) {
+            EndDrawing();
+        }
+        
+        //The next view is ready once the simulation catches up
+        double wait_start = GetTime();
+        PipelineWait(pipeline);
+        front = 1-front;
+        
+        //Drawing plus however long the simulation ran past it
+        float work_ms = (float)((draw_end-frame_start) + (GetTime()-wait_start))*1000.0f;
+        
+        if (UpdateGovernor(&governor, work_ms)) {
+            quality = GovernorQuality(&governor);
+            game->particle_emission = quality->particle_emission;
+        }
+        
+        PROFILE_END_FRAME();
+        
+        if (sim.replay_finished) {
+            break;
+        }
+        
+        //out of memory for the recording, keep playing without it
+        if (sim.recording_failed) {
+            StopRecording(recorder, game);
+            printf("recording to %s stopped at tick %llu, out of memory\n", record_path, game->tick);
+            recorder = NULL;
+            sim.recording_failed = false;
+            governor.held = replay != NULL;
+        }
+    }
+    
+    printf(
+        "frame arena: high water %zu of %zu bytes, %d frames overflowed\n",
+        frame_arena.high_water,
+        frame_arena.capacity,
+        frame_arena.overflow_frames
+    );
+    
+    if (replay) {
+        double seconds = GetTime()-replay_start;
+        long long diverged = ReplayDivergedAt(replay);
+        
+        printf("replay: %llu ticks in %.2f s, %.0f ticks/s\n", game->tick, seconds, game->tick/seconds);
+        
+        if (diverged >= 0) {
+            printf("replay: diverged from the recording by tick %lld\n", diverged);
+        }
+        
+        else {
+            printf("replay: matched the recording\n");
+        }
         
-        EndDrawing();
+        CloseReplay(replay);
+    }
+    
+    if (recorder && !StopRecording(recorder, game)) {
+        printf("recording to %s stopped early, out of memory\n", record_path);
+    }
+    
+    if (batch_loaded) {
+        UnloadParticleBatch(&particle_batch);
     }
     
+    UnloadStarfield(&starfield);
+    
+    if (atlas_loaded) {
+        UnloadAsteroidAtlas(&asteroid_atlas);
+    }
+    
+    #ifdef PROFILE
+    ProfileCloseCsv();
+    #endif
+    
+    DestroyPipeline(pipeline);
+    ArenaFree(&frame_arena);
+    DestroyJobSystem(game->jobs);
+    DestroyJobSystem(render_jobs);
     DeInitGame(game);
+    DeInitGame(views[0].game);
+    DeInitGame(views[1].game);
+    FreeSnapshot(&save_state);
     
     return 0;
 }
\ No newline at end of file
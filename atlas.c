@@ -0,0 +1,82 @@
+#include <math.h>
+#include "raylib.h"
+#include "atlas.h"
+
+#define ROWS_PER_SIZE (ASTEROID_ATLAS_ANGLES/ASTEROID_ATLAS_COLUMNS)
+#define DEGREES_PER_ANGLE (360.0f/ASTEROID_ATLAS_ANGLES)
+
+bool LoadAsteroidAtlas(AsteroidAtlas *atlas, const GameData *game) {
+    int width = 0;
+    int height = 0;
+
+    //one block of rows per size, each cell just big enough for the bounding circle
+    for (int size = 1; size <= ASTEROID_MAX_SIZE; size++) {
+        int cell = (int)ceilf(2*game->asteroid_radius[size])+4;
+
+        atlas->row_y[size] = height;
+        atlas->cell_size[size] = cell;
+        height += cell*ROWS_PER_SIZE;
+
+        if (cell*ASTEROID_ATLAS_COLUMNS > width) {
+            width = cell*ASTEROID_ATLAS_COLUMNS;
+        }
+    }
+
+    atlas->target = LoadRenderTexture(width, height);
+
+    if (atlas->target.id == 0) {
+        return false;
+    }
+
+    Vector2 outline[ASTEROID_GRAPHIC_LENGTH];
+
+    BeginTextureMode(atlas->target);
+        ClearBackground(BLANK);
+
+        for (int size = 1; size <= ASTEROID_MAX_SIZE; size++) {
+            int cell = atlas->cell_size[size];
+
+            for (int angle = 0; angle < ASTEROID_ATLAS_ANGLES; angle++) {
+                Vector2 center = {
+                    (angle%ASTEROID_ATLAS_COLUMNS)*cell + cell*0.5f,
+                    atlas->row_y[size] + (angle/ASTEROID_ATLAS_COLUMNS)*cell + cell*0.5f
+                };
+
+                TransformPolygon(
+                    game->asteroid_graphic,
+                    ASTEROID_GRAPHIC_LENGTH,
+                    angle*DEGREES_PER_ANGLE,
+                    center,
+                    1/(float)size,
+                    outline
+                );
+
+                DrawLineStrip(outline, ASTEROID_GRAPHIC_LENGTH, WHITE);
+            }
+        }
+
+    EndTextureMode();
+
+    SetTextureFilter(atlas->target.texture, TEXTURE_FILTER_BILINEAR);
+    return true;
+}
+
+void UnloadAsteroidAtlas(AsteroidAtlas *atlas) {
+    UnloadRenderTexture(atlas->target);
+}
+
+void DrawAsteroidSprite(const AsteroidAtlas *atlas, int size, float rotation, Vector2 position, Color color) {
+    int cell = atlas->cell_size[size];
+    int steps = (int)floorf(rotation/DEGREES_PER_ANGLE + 0.5f);
+    float leftover = rotation - steps*DEGREES_PER_ANGLE;
+    int angle = steps & (ASTEROID_ATLAS_ANGLES-1);
+
+    float x = (angle%ASTEROID_ATLAS_COLUMNS)*cell;
+    float y = atlas->row_y[size] + (angle/ASTEROID_ATLAS_COLUMNS)*cell;
+
+    //render textures are upside down, so count the cell from the bottom and flip it
+    Rectangle source = {x, atlas->target.texture.height - y - cell, cell, -cell};
+    Rectangle dest = {position.x, position.y, cell, cell};
+
+    DrawTexturePro(atlas->target.texture, source, dest, (Vector2){cell*0.5f, cell*0.5f}, leftover, color);
+}
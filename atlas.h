@@ -0,0 +1,37 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+/*
+    Asteroid outlines drawn once into a texture at every size and
+    ASTEROID_ATLAS_ANGLES rotations, so an asteroid is one textured quad
+    instead of a line strip. Every quad comes from the same texture, so
+    raylib batches all of them into one draw call.
+
+    The nearest rotation is picked and the quad turned by whatever is left
+    over, at most half a step, so asteroids still spin smoothly.
+*/
+
+#include <stdbool.h>
+#include "raylib.h"
+#include "game.h"
+
+//A power of two
+#define ASTEROID_ATLAS_ANGLES 64
+//Cells per row of the atlas, ASTEROID_ATLAS_ANGLES must divide by it
+#define ASTEROID_ATLAS_COLUMNS 16
+
+typedef struct AsteroidAtlas {
+    RenderTexture2D target;
+    //first row of cells for each size, in texture pixels from the top
+    int row_y[ASTEROID_MAX_SIZE+1];
+    int cell_size[ASTEROID_MAX_SIZE+1];
+} AsteroidAtlas;
+
+//Draws game's asteroid_graphic into the atlas. Needs a window.
+bool LoadAsteroidAtlas(AsteroidAtlas *atlas, const GameData *game);
+void UnloadAsteroidAtlas(AsteroidAtlas *atlas);
+
+//Same outline TransformPolygon gives for rotation, position and 1/size
+void DrawAsteroidSprite(const AsteroidAtlas *atlas, int size, float rotation, Vector2 position, Color color);
+
+#endif
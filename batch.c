@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include "raylib.h"
+#include "raymath.h"
+#include "rlgl.h"
+#include "batch.h"
+
+//Each quad runs from x = 0 at the particle to x = 1 at the trail end, y is the side
+static const char *segment_vs =
+    "#version 330\n"
+    "in vec2 corner;\n"
+    "in vec4 segment;\n"
+    "uniform mat4 mvp;\n"
+    "void main() {\n"
+    "    vec2 along = segment.zw - segment.xy;\n"
+    "    float size = length(along);\n"
+    "    along = size > 0.0001 ? along/size : vec2(1.0, 0.0);\n"
+    "    vec2 side = vec2(-along.y, along.x)*0.5;\n"
+    "    vec2 position = mix(segment.xy, segment.zw, corner.x) + side*corner.y;\n"
+    "    gl_Position = mvp*vec4(position, 0.0, 1.0);\n"
+    "}\n";
+
+static const char *segment_fs =
+    "#version 330\n"
+    "uniform vec4 color;\n"
+    "out vec4 finalColor;\n"
+    "void main() {\n"
+    "    finalColor = color;\n"
+    "}\n";
+
+static const float quad[] = {
+    0, -1,  1, -1,  1, 1,
+    0, -1,  1,  1,  0, 1
+};
+
+//rlSetVertexAttribute took a pointer before raylib 5
+#if RAYLIB_VERSION_MAJOR >= 5
+    #define ATTRIBUTE_OFFSET 0
+#else
+    #define ATTRIBUTE_OFFSET NULL
+#endif
+
+bool LoadParticleBatch(ParticleBatch *batch, int capacity) {
+    batch->shader = rlLoadShaderCode(segment_vs, segment_fs);
+
+    if (batch->shader == 0) {
+        return false;
+    }
+
+    batch->segments = malloc(sizeof(float)*4*capacity);
+
+    if (batch->segments == NULL) {
+        rlUnloadShaderProgram(batch->shader);
+        return false;
+    }
+
+    batch->capacity       = capacity;
+    batch->mvp_location   = rlGetLocationUniform(batch->shader, "mvp");
+    batch->color_location = rlGetLocationUniform(batch->shader, "color");
+
+    int corner_location  = rlGetLocationAttrib(batch->shader, "corner");
+    int segment_location = rlGetLocationAttrib(batch->shader, "segment");
+
+    batch->vao = rlLoadVertexArray();
+    rlEnableVertexArray(batch->vao);
+
+    batch->quad_vbo = rlLoadVertexBuffer(quad, sizeof(quad), false);
+    rlSetVertexAttribute(corner_location, 2, RL_FLOAT, false, 0, ATTRIBUTE_OFFSET);
+    rlEnableVertexAttribute(corner_location);
+
+    batch->segment_vbo = rlLoadVertexBuffer(NULL, sizeof(float)*4*capacity, true);
+    rlSetVertexAttribute(segment_location, 4, RL_FLOAT, false, 0, ATTRIBUTE_OFFSET);
+    rlEnableVertexAttribute(segment_location);
+    rlSetVertexAttributeDivisor(segment_location, 1);
+
+    rlDisableVertexArray();
+
+    return true;
+}
+
+void UnloadParticleBatch(ParticleBatch *batch) {
+    rlUnloadVertexArray(batch->vao);
+    rlUnloadVertexBuffer(batch->quad_vbo);
+    rlUnloadVertexBuffer(batch->segment_vbo);
+    rlUnloadShaderProgram(batch->shader);
+    free(batch->segments);
+    batch->segments = NULL;
+    batch->capacity = 0;
+}
+
+typedef struct FillJob {
+    GameData *game;
+    float *out;
+    //pool slot of element 0
+    int start;
+    float alpha;
+    float trail;
+} FillJob;
+
+static void FillSegmentChunk(void *data, int begin, int end, int chunk) {
+    (void)chunk;
+    FillJob *job = data;
+    GameData *game = job->game;
+
+    for (int p = begin; p < end; p++) {
+        float *out = &job->out[p*4];
+
+        //an expired analytic particle becomes a zero length quad off screen
+        if (!ParticleSegment(game, job->start+p, job->alpha, job->trail, out)) {
+            out[0] = out[1] = out[2] = out[3] = -1.0f;
+        }
+    }
+}
+
+void DrawParticleBatch(ParticleBatch *batch, GameData *game, float alpha, float trail, Color color) {
+    int count = 0;
+
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(&game->particles, s, &start);
+
+        if (count+length > batch->capacity) {
+            length = batch->capacity-count;
+        }
+
+        FillJob job = {game, &batch->segments[count*4], start, alpha, trail};
+        ParallelFor(game->jobs, length, UPDATE_CHUNK_SIZE, FillSegmentChunk, &job);
+        count += length;
+    }
+
+    if (count == 0) {
+        return;
+    }
+
+    //anything raylib has queued was drawn before us
+    rlDrawRenderBatchActive();
+
+    rlUpdateVertexBuffer(batch->segment_vbo, batch->segments, sizeof(float)*4*count, 0);
+
+    float rgba[4] = {color.r/255.0f, color.g/255.0f, color.b/255.0f, color.a/255.0f};
+    Matrix mvp = MatrixMultiply(rlGetMatrixModelview(), rlGetMatrixProjection());
+
+    rlEnableShader(batch->shader);
+    rlSetUniformMatrix(batch->mvp_location, mvp);
+    rlSetUniform(batch->color_location, rgba, RL_SHADER_UNIFORM_VEC4, 1);
+
+    rlEnableVertexArray(batch->vao);
+    rlDrawVertexArrayInstanced(0, 6, count);
+    rlDisableVertexArray();
+    rlDisableShader();
+}
@@ -0,0 +1,41 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/*
+    Particle renderer that submits every particle in one instanced draw.
+
+    Each particle becomes one instance of a one pixel wide quad stretched
+    between its position and the end of its trail. ParticleSegment works
+    the ends out on the CPU straight into a single vertex buffer, split
+    over game->jobs, and uploaded once a frame. Analytic particles are
+    placed from their age there too. Needs raylib's OpenGL 3.3 backend.
+*/
+
+#include <stdbool.h>
+#include "raylib.h"
+#include "game.h"
+
+typedef struct ParticleBatch {
+    unsigned int vao;
+    unsigned int quad_vbo;
+    unsigned int segment_vbo;
+    unsigned int shader;
+    int mvp_location;
+    int color_location;
+    //start x, start y, end x, end y per particle
+    float *segments;
+    int capacity;
+} ParticleBatch;
+
+//capacity is the most particles drawn in one call. Needs an OpenGL context.
+bool LoadParticleBatch(ParticleBatch *batch, int capacity);
+void UnloadParticleBatch(ParticleBatch *batch);
+
+/*
+    Draws every live particle alpha of the way from the previous tick to the
+    current one, trails scaled by trail, flushing raylib's own batch first
+    so order holds.
+*/
+void DrawParticleBatch(ParticleBatch *batch, GameData *game, float alpha, float trail, Color color);
+
+#endif
@@ -0,0 +1,1076 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+#include "game.h"
+#include "integrate.h"
+#include "profile.h"
+#include "replay.h"
+#include "draw.h"
+#include "snapshot.h"
+
+#if defined(_WIN32)
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+/*
+    Headless benchmarks for the simulation. Build without raylib:
+
+        gcc -O2 -DPROFILE -DBENCH_COUNT_ALLOCATIONS bench.c game.c pool.c integrate.c jobs.c grid.c draw.c render_null.c profile.c replay.c snapshot.c -o bench -lm -lpthread -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+
+    With no arguments it checks the SIMD and threaded paths against the
+    plain ones and prints micro benchmarks. With --scenario it runs whole
+    games instead and prints JSON:
+
+        bench --scenario all|NAME [--workers N]
+        bench --replay FILE [--workers N]
+        bench --draw-dump FILE
+
+    -DPROFILE adds per phase timings to the JSON and BENCH_COUNT_ALLOCATIONS
+    (with the --wrap flags, GNU ld only) counts heap allocations made while
+    a scenario is being timed. --draw-dump writes the commands of the
+    biggest draw benchmark frame to FILE, one per line.
+*/
+
+static double Seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+//Cost of a 900 particle player death burst with the pool filled to fill_percent
+static void BenchSpawnBurst(int max_particles, int fill_percent) {
+    int bursts = 100;
+    int burst_size = 900;
+    double elapsed[2];
+
+    //one SpawnParticle per particle, then one SpawnParticleBurst per burst
+    for (int method = 0; method < 2; method++) {
+        GameData *game = InitNewGame(600, 800, 20, max_particles, 10, 1);
+        int fill = (int)((long long)max_particles*fill_percent/100);
+
+        for (int i = 0; i < fill; i++) {
+            SpawnParticle(game, (Vector2){400, 300}, (Vector2){0, 0}, i%360, 100, 1.0f/144);
+        }
+
+        ParticleEmitter burst = {
+            .position    = {400, 300},
+            .angle       = 180,
+            .spread      = 180,
+            .min_speed   = 1,
+            .max_speed   = 100,
+            .fast_chance = 0.5f,
+            .fast_speed  = 300,
+            .count       = burst_size
+        };
+
+        double start = Seconds();
+
+        for (int b = 0; b < bursts; b++) {
+            if (method == 0) {
+                for (int i = 0; i < burst_size; i++) {
+                    SpawnParticle(game, (Vector2){400, 300}, (Vector2){0, 0}, RngRange(&game->rng, 0, 360), 300, 1.0f/144);
+                }
+            }
+
+            else {
+                SpawnParticleBurst(game, &burst, 1.0f/144);
+            }
+        }
+
+        elapsed[method] = Seconds()-start;
+        DeInitGame(game);
+    }
+
+    printf("spawn burst  capacity %8d  fill %3d%%  %8.2f ns/particle one at a time  %8.2f ns/particle burst\n",
+        max_particles, fill_percent, elapsed[0]*1e9/(bursts*burst_size), elapsed[1]*1e9/(bursts*burst_size));
+}
+
+/*
+    The integrate kernels must move everything exactly like UpdatePosition
+    and flag exactly what OffScreen and the age check would. Returns the
+    number of mismatches.
+*/
+static int CheckIntegrateKernels(int count) {
+    Rng rng;
+    RngSeed(&rng, 7);
+    int width = 800;
+    int height = 600;
+    float delta_time = 1.0f/144;
+
+    float *x = malloc(sizeof(float)*count);
+    float *y = malloc(sizeof(float)*count);
+    float *vx = malloc(sizeof(float)*count);
+    float *vy = malloc(sizeof(float)*count);
+    float *time = malloc(sizeof(float)*count);
+    unsigned char *flags = malloc(count);
+    Vector2 *expected = malloc(sizeof(Vector2)*count);
+    int mismatches = 0;
+
+    for (int wrap = 0; wrap < 2; wrap++) {
+
+        RngFillFloat(&rng, x, count, -40, width+40);
+        RngFillFloat(&rng, y, count, -40, height+40);
+        RngFillFloat(&rng, vx, count, -30, 30);
+        RngFillFloat(&rng, vy, count, -30, 30);
+        RngFillFloat(&rng, time, count, 2.9f, 3.1f);
+
+        for (int i = 0; i < count; i++) {
+            expected[i] = UpdatePosition((Vector2){x[i], y[i]}, (Vector2){vx[i], vy[i]}, width, height, wrap);
+        }
+
+        float *old_time = malloc(sizeof(float)*count);
+
+        for (int i = 0; i < count; i++) {
+            old_time[i] = time[i];
+        }
+
+        if (wrap) {
+            IntegrateWrapped(x, y, vx, vy, count, width, height);
+        }
+
+        else {
+            IntegrateParticles(x, y, vx, vy, time, flags, count, delta_time, PARTICLE_OLD_AGE, width, height);
+        }
+
+        for (int i = 0; i < count; i++) {
+            bool same = x[i] == expected[i].x && y[i] == expected[i].y;
+
+            if (!wrap) {
+                float t = old_time[i]+delta_time;
+                unsigned char f = 0;
+
+                if (OffScreen(expected[i], width, height)) {
+                    f |= INTEGRATE_OFFSCREEN;
+                }
+
+                if (t > PARTICLE_OLD_AGE) {
+                    f |= INTEGRATE_OLD;
+                }
+
+                same = same && time[i] == t && flags[i] == f;
+            }
+
+            if (!same) {
+                mismatches++;
+            }
+        }
+
+        free(old_time);
+    }
+
+    free(x);
+    free(y);
+    free(vx);
+    free(vy);
+    free(time);
+    free(flags);
+    free(expected);
+
+    return mismatches;
+}
+
+//Integration cost per particle for a full pool
+static void BenchIntegrate(int count) {
+    float *x = calloc(count, sizeof(float));
+    float *y = calloc(count, sizeof(float));
+    float *vx = calloc(count, sizeof(float));
+    float *vy = calloc(count, sizeof(float));
+    float *time = calloc(count, sizeof(float));
+    unsigned char *flags = malloc(count);
+    int ticks = 100;
+    double simd = 0;
+    double scalar = 0;
+
+    for (int t = 0; t < ticks; t++) {
+        double start = Seconds();
+        IntegrateParticles(x, y, vx, vy, time, flags, count, 1.0f/144, PARTICLE_OLD_AGE, 800, 600);
+        simd += Seconds()-start;
+
+        start = Seconds();
+        IntegrateParticlesScalar(x, y, vx, vy, time, flags, count, 1.0f/144, PARTICLE_OLD_AGE, 800, 600);
+        scalar += Seconds()-start;
+    }
+
+    printf("integrate    particles %8d  simd %6.3f ms/tick  scalar %6.3f ms/tick\n",
+        count, simd*1e3/ticks, scalar*1e3/ticks);
+
+    free(x);
+    free(y);
+    free(vx);
+    free(vy);
+    free(time);
+    free(flags);
+}
+
+/*
+    Broadphase cost as the asteroid field grows: building the grid plus one
+    query per missile and one for the player, as a tick does.
+*/
+static void BenchAsteroidGrid(int asteroid_count, int missile_count) {
+    GameData *game = InitNewGame(600, 800, asteroid_count, 1000, missile_count, 5);
+
+    for (int i = 0; i < asteroid_count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnAsteroid(game, 1+2*RngRange(&game->rng, 0, 2), position, RngRange(&game->rng, 0, 360), 50, 1.0f/144);
+    }
+
+    int ticks = 200;
+    long long candidates = 0;
+    double start = Seconds();
+
+    for (int t = 0; t < ticks; t++) {
+        BuildAsteroidGrid(game);
+
+        for (int m = 0; m <= missile_count; m++) {
+            float x = (m*7919)%800;
+            float y = (m*104729)%600;
+            candidates += GridQuery(&game->asteroid_grid, x, y, 58, game->grid_candidates);
+        }
+    }
+
+    double elapsed = Seconds()-start;
+    printf("broadphase   asteroids %8d  queries %4d  %8.2f us/tick  %6.1f candidates/query\n",
+        asteroid_count, missile_count+1, elapsed*1e6/ticks, (double)candidates/(ticks*(missile_count+1)));
+
+    DeInitGame(game);
+}
+
+//Outline of every asteroid each tick: trig per asteroid against a shape table lookup
+static void BenchAsteroidShapes(int asteroid_count) {
+    GameData *game = InitNewGame(600, 800, asteroid_count, 1000, 10, 5);
+
+    for (int i = 0; i < asteroid_count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnAsteroid(game, 1+2*RngRange(&game->rng, 0, 2), position, RngRange(&game->rng, 0, 360), 50, 1.0f/144);
+    }
+
+    int ticks = 200;
+    double trig = 0;
+    double table = 0;
+
+    for (int t = 0; t < ticks; t++) {
+        double start = Seconds();
+
+        for (int i = 0; i < asteroid_count; i++) {
+            TransformPolygon(
+                game->asteroid_graphic,
+                ASTEROID_GRAPHIC_LENGTH,
+                game->asteroid_rotation[i]+t,
+                (Vector2){game->asteroid_x[i], game->asteroid_y[i]},
+                1/(float)game->asteroid_sizes[i],
+                &game->asteroid_polygons[i*ASTEROID_GRAPHIC_LENGTH]
+            );
+        }
+
+        trig += Seconds()-start;
+        start = Seconds();
+
+        for (int i = 0; i < asteroid_count; i++) {
+            game->asteroid_rotation[i] += 1;
+            TransformAsteroid(game, i);
+        }
+
+        table += Seconds()-start;
+    }
+
+    printf("shapes       asteroids %8d  trig %8.2f us/tick  table %8.2f us/tick\n",
+        asteroid_count, trig*1e6/ticks, table*1e6/ticks);
+
+    DeInitGame(game);
+}
+
+//How many exact polygon tests the bounding circles save around the player
+static void BenchPlayerCollision(int asteroid_count) {
+    GameData *game = InitNewGame(600, 800, asteroid_count, 100000, 10, 9);
+
+    for (int i = 0; i < asteroid_count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnAsteroid(game, 1+2*RngRange(&game->rng, 0, 2), position, RngRange(&game->rng, 0, 360), 50, 1.0f/144);
+    }
+
+    int ticks = 10000;
+    CollisionStats total = {0};
+    int hits = 0;
+    double start = Seconds();
+
+    for (int t = 0; t < ticks; t++) {
+        game->player_position = (Vector2){(t*7919)%800, (t*104729)%600};
+        PlaceShape(game->shapes->ship[ShapeAngle(t%360)], SHIP_GRAPHIC_LENGTH, game->player_position, game->ship_polygon);
+        game->collision_stats = (CollisionStats){0};
+        BuildAsteroidGrid(game);
+        hits += CheckPlayerCollision(game, 1.0f/144);
+        SweepDeadEntities(game);
+
+        total.candidates += game->collision_stats.candidates;
+        total.bounding_rejects += game->collision_stats.bounding_rejects;
+        total.exact_tests += game->collision_stats.exact_tests;
+    }
+
+    double elapsed = Seconds()-start;
+    printf("player hit   asteroids %8d  %6.2f us/tick  candidates %6.1f  skipped %6.1f  exact %5.2f  hits %d\n",
+        asteroid_count, elapsed*1e6/ticks, (double)total.candidates/ticks,
+        (double)total.bounding_rejects/ticks, (double)total.exact_tests/ticks, hits);
+
+    DeInitGame(game);
+}
+
+static uint32_t HashParticles(GameData *game) {
+    uint32_t hash = 2166136261u;
+
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(&game->particles, s, &start);
+
+        for (int i = start; i < start+length; i++) {
+            uint32_t bits[2];
+            memcpy(&bits[0], &game->particle_x[i], 4);
+            memcpy(&bits[1], &game->particle_y[i], 4);
+            hash = (hash ^ bits[0])*16777619u;
+            hash = (hash ^ bits[1])*16777619u;
+        }
+    }
+
+    return hash;
+}
+
+//The line and circle world drawn into the null backend, the CPU side of a frame with no GPU in the way
+static void BenchDraw(int particle_count, int asteroid_count, const char *dump_path) {
+    GameData *game = InitNewGame(600, 800, asteroid_count, particle_count, 1000, 15);
+
+    for (int i = 0; i < asteroid_count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnAsteroid(game, 1+2*RngRange(&game->rng, 0, 2), position, RngRange(&game->rng, 0, 360), 50, 1.0f/144);
+    }
+
+    for (int i = 0; i < particle_count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnParticle(game, position, (Vector2){0, 0}, RngRange(&game->rng, 0, 360), 100, 1.0f/144);
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnMissile(game, position, RngRange(&game->rng, 0, 360), 300, 1.0f/144);
+    }
+
+    int frames = 20;
+    double elapsed = 0;
+    Color white = {255, 255, 255, 255};
+
+    for (int f = 0; f < frames; f++) {
+        RenderBeginFrame();
+        double start = Seconds();
+
+        DrawAsteroidOutlines(game, 0.5f, white);
+        DrawParticleLines(game, 0.5f, 1.0f, white);
+        DrawMissiles(game, 0.5f, white);
+
+        elapsed += Seconds()-start;
+    }
+
+    RenderStats stats = RenderGetStats();
+
+    printf("draw         particles %8d  asteroids %6d  %8.3f ms/frame  %8d draws  %10lld vertices\n",
+        particle_count, asteroid_count, elapsed*1e3/frames, stats.draws, stats.vertices);
+
+    if (dump_path) {
+        FILE *file = fopen(dump_path, "w");
+
+        if (file) {
+            RenderDump(file);
+            fclose(file);
+        }
+
+        else {
+            fprintf(stderr, "couldn't write %s\n", dump_path);
+        }
+    }
+
+    DeInitGame(game);
+}
+
+/*
+    1M live particles updated with different worker counts. Every run has
+    to end in the same state, only the time should change.
+*/
+static int BenchParallelParticles(int count, int ticks) {
+    int worker_counts[] = {0, 1, 3, 7, DefaultWorkerCount()};
+    uint32_t first_hash = 0;
+    int mismatches = 0;
+
+    for (int w = 0; w < 5; w++) {
+        GameData *game = InitNewGame(600, 800, 20, count, 10, 3);
+        game->jobs = CreateJobSystem(worker_counts[w]);
+
+        //slow particles spread over the screen, many old enough to expire
+        for (int i = 0; i < count; i++) {
+            Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+            SpawnParticle(game, position, (Vector2){0, 0}, RngRange(&game->rng, 0, 360), 10, 1.0f/144);
+            game->particle_time[i] = RngRange(&game->rng, 0, 4000)/1000.0f;
+        }
+
+        double start = Seconds();
+
+        for (int t = 0; t < ticks; t++) {
+            UpdateParticles(game, 1.0f/144);
+            SweepDeadEntities(game);
+        }
+
+        double elapsed = Seconds()-start;
+        uint32_t hash = HashParticles(game);
+
+        if (w == 0) {
+            first_hash = hash;
+        }
+
+        else if (hash != first_hash) {
+            mismatches++;
+        }
+
+        printf("update       particles %8d  workers %2d  %6.3f ms/tick  live %d  hash %08x\n",
+            count, worker_counts[w], elapsed*1e3/ticks, game->particles.count, hash);
+
+        DestroyJobSystem(game->jobs);
+        DeInitGame(game);
+    }
+
+    return mismatches;
+}
+
+/*
+    Scenarios
+*/
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void *pointer, size_t size);
+
+static atomic_llong allocation_count;
+static atomic_llong allocation_bytes;
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add(&allocation_count, 1);
+    atomic_fetch_add(&allocation_bytes, (long long)size);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    atomic_fetch_add(&allocation_count, 1);
+    atomic_fetch_add(&allocation_bytes, (long long)(count*size));
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void *pointer, size_t size) {
+    atomic_fetch_add(&allocation_count, 1);
+    atomic_fetch_add(&allocation_bytes, (long long)size);
+    return __real_realloc(pointer, size);
+}
+#endif
+
+//Largest resident set the process has had so far, in KiB
+static long PeakRssKiB(void) {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+
+    return (long)(counters.PeakWorkingSetSize/1024);
+#else
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+
+    //kilobytes on Linux, bytes on macOS
+#if defined(__APPLE__)
+    return usage.ru_maxrss/1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+//Resident set right now in KiB, or -1 where there is no cheap way to ask
+static long RssKiB(void) {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return -1;
+    }
+
+    return (long)(counters.WorkingSetSize/1024);
+#elif defined(__linux__)
+    FILE *statm = fopen("/proc/self/statm", "r");
+    long size = 0;
+    long resident = -1;
+
+    if (statm == NULL) {
+        return -1;
+    }
+
+    if (fscanf(statm, "%ld %ld", &size, &resident) != 2) {
+        resident = -1;
+    }
+
+    fclose(statm);
+    return resident < 0 ? -1 : resident*(sysconf(_SC_PAGESIZE)/1024);
+#else
+    return -1;
+#endif
+}
+
+#define SCENARIO_DELTA_TIME (1.0f/144)
+
+typedef struct Scenario {
+    const char *name;
+    unsigned int seed;
+    int max_asteroids;
+    int max_particles;
+    int max_missiles;
+    int warmup_ticks;
+    int ticks;
+    //runs once after InitNewGame
+    void (*setup)(GameData *game);
+    //runs before every tick, outside the timed part
+    void (*before_tick)(GameData *game, Input *input);
+} Scenario;
+
+static void FillParticles(GameData *game) {
+    //slow particles spread over the screen, some old enough to expire
+    while (game->particles.count < game->particles.capacity) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        int index = game->particles.count;
+        SpawnParticle(game, position, (Vector2){0, 0}, RngRange(&game->rng, 0, 360), 10, SCENARIO_DELTA_TIME);
+        game->particle_time[PoolSlot(&game->particles, index)] = RngRange(&game->rng, 0, 4000)/1000.0f;
+    }
+}
+
+//The same pool switched to analytic particles, which carries their ages over
+static void FillAnalyticParticles(GameData *game) {
+    FillParticles(game);
+    SetParticleMode(game, PARTICLES_ANALYTIC, SCENARIO_DELTA_TIME);
+}
+
+static void TopUpParticles(GameData *game, Input *input) {
+    (void)input;
+    FillParticles(game);
+}
+
+//Parks the vulnerable ship on a fresh large asteroid so it dies every tick
+static void KillPlayer(GameData *game, Input *input) {
+    (void)input;
+    game->invicibility_time = 0.0f;
+    game->player_cooldown = 0.0f;
+    SpawnAsteroid(game, 1, game->player_position, 0, 0, SCENARIO_DELTA_TIME);
+}
+
+static void SpawnLargeAsteroids(GameData *game) {
+    for (int i = 0; i < 2000; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnAsteroid(game, 1, position, RngRange(&game->rng, 0, 360), 50, SCENARIO_DELTA_TIME);
+    }
+
+    //keep the ship out of it
+    game->invicibility_time = 1e9f;
+}
+
+//A missile on top of the first 64 live asteroids every tick
+static void ShootAsteroids(GameData *game, Input *input) {
+    (void)input;
+    int targets = game->asteroids.count < 64 ? game->asteroids.count : 64;
+
+    for (int i = 0; i < targets; i++) {
+        int slot = PoolSlot(&game->asteroids, i);
+        Vector2 position = {game->asteroid_x[slot], game->asteroid_y[slot]};
+        SpawnMissile(game, position, RngRange(&game->rng, 0, 360), 500, SCENARIO_DELTA_TIME);
+    }
+}
+
+//The fire key every tick plus 64 more missiles fanned out from the ship
+static void SpamMissiles(GameData *game, Input *input) {
+    input->fire = true;
+    input->rotate_left = true;
+    game->invicibility_time = 1e9f;
+
+    for (int i = 0; i < 64; i++) {
+        SpawnMissile(game, game->player_position, RngRange(&game->rng, 0, 360), 500, SCENARIO_DELTA_TIME);
+    }
+}
+
+//A world 25 screens each way, the first wave puts a third of the pool in it
+static void LargeWorld(GameData *game) {
+    if (!SetWorldSize(game, 20000, 15000)) {
+        fprintf(stderr, "out of memory for the large world\n");
+        exit(1);
+    }
+
+    game->invicibility_time = 1e9f;
+}
+
+//Flies the ship round in wide circles, shooting, so the camera keeps crossing chunks
+static void FlyAround(GameData *game, Input *input) {
+    input->thrust = true;
+    input->rotate_left = game->tick%720 < 40;
+    input->fire = game->tick%8 == 0;
+}
+
+static const Scenario scenarios[] = {
+    {"particles_1m_steady",     11, 20,    1000000, 10,   60, 300, FillParticles,         TopUpParticles},
+    {"particles_1m_analytic",   11, 20,    1000000, 10,   60, 300, FillAnalyticParticles, TopUpParticles},
+    {"player_death_bursts",     12, 2000,  1000000, 10,   60, 300, FillParticles,         KillPlayer},
+    {"asteroid_split_cascade",  13, 8000,  100000,  4096, 0,  300, SpawnLargeAsteroids,   ShootAsteroids},
+    {"missile_spam",            14, 200,   100000,  8192, 60, 300, NULL,                  SpamMissiles},
+    {"large_world_40k",         15, 120000, 100000, 64,   60, 300, LargeWorld,            FlyAround},
+};
+
+#define SCENARIO_COUNT (int)(sizeof(scenarios)/sizeof(scenarios[0]))
+
+typedef struct ScenarioResult {
+    int ticks;
+    double seconds;
+    long long entity_updates;
+    //analytic particles alive at each tick, never updated so kept out of entity_updates
+    long long analytic_particles;
+    long long allocations;
+    long long allocated_bytes;
+} ScenarioResult;
+
+static void BeginTimedTicks(void) {
+#ifdef BENCH_COUNT_ALLOCATIONS
+    atomic_store(&allocation_count, 0);
+    atomic_store(&allocation_bytes, 0);
+#endif
+#ifdef PROFILE
+    ProfileReset();
+#endif
+}
+
+static void EndTimedTicks(ScenarioResult *result) {
+#ifdef BENCH_COUNT_ALLOCATIONS
+    result->allocations = atomic_load(&allocation_count);
+    result->allocated_bytes = atomic_load(&allocation_bytes);
+#else
+    result->allocations = -1;
+    result->allocated_bytes = -1;
+#endif
+}
+
+//One timed GameStep, only the step itself counts towards the result
+static void TimedStep(GameData *game, const Input *input, float delta_time, ScenarioResult *result) {
+    result->entity_updates += game->asteroids.count + game->missiles.count;
+
+    if (game->particle_mode == PARTICLES_ANALYTIC) {
+        result->analytic_particles += game->particles.count;
+    }
+
+    else {
+        result->entity_updates += game->particles.count;
+    }
+
+    PROFILE_BEGIN_FRAME();
+    double start = Seconds();
+
+    PROFILE_SCOPE(PROFILE_GAME_STEP) {
+        GameStep(game, input, delta_time);
+    }
+
+    result->seconds += Seconds()-start;
+    PROFILE_END_FRAME();
+
+    result->ticks++;
+}
+
+static void PrintResult(const char *name, unsigned int seed, int workers, const GameData *game, const ScenarioResult *result, bool last) {
+    PoolMemory memory = GameMemory(game);
+
+    printf("  {\n");
+    printf("    \"scenario\": \"%s\",\n", name);
+    printf("    \"seed\": %u,\n", seed);
+    printf("    \"workers\": %d,\n", workers);
+    printf("    \"ticks\": %d,\n", result->ticks);
+    printf("    \"ms_per_tick\": %.4f,\n", result->seconds*1e3/result->ticks);
+    printf("    \"entity_updates\": %lld,\n", result->entity_updates);
+    printf("    \"ns_per_entity_update\": %.3f,\n",
+        result->entity_updates ? result->seconds*1e9/result->entity_updates : 0.0);
+    printf("    \"analytic_particles\": %lld,\n", result->analytic_particles);
+    printf("    \"allocations\": %lld,\n", result->allocations);
+    printf("    \"allocated_bytes\": %lld,\n", result->allocated_bytes);
+    printf("    \"peak_rss_kib\": %ld,\n", PeakRssKiB());
+    printf("    \"rss_kib\": %ld,\n", RssKiB());
+    printf("    \"pool_reserved_kib\": %zu,\n", memory.reserved/1024);
+    printf("    \"pool_committed_kib\": %zu,\n", memory.committed/1024);
+    printf("    \"pool_peak_committed_kib\": %zu,\n", memory.peak_committed/1024);
+    printf("    \"phases\": {");
+
+#ifdef PROFILE
+    //only the simulation phases, the rest belong to the frontend
+    for (int p = PROFILE_GAME_STEP; p <= PROFILE_SWEEP; p++) {
+        ProfileStats stats = ProfileGetStats(p);
+        printf("%s\n      \"%s\": {\"min_ms\": %.4f, \"avg_ms\": %.4f, \"p99_ms\": %.4f}",
+            p == PROFILE_GAME_STEP ? "" : ",", ProfilePhaseName(p), stats.min_ms, stats.average_ms, stats.p99_ms);
+    }
+
+    printf("\n    ");
+#endif
+
+    printf("}\n");
+    printf("  }%s\n", last ? "" : ",");
+}
+
+static void RunScenario(const Scenario *scenario, int workers, bool last) {
+    GameData *game = InitNewGame(600, 800, scenario->max_asteroids, scenario->max_particles, scenario->max_missiles, scenario->seed);
+
+    if (game == NULL) {
+        fprintf(stderr, "out of memory for %s\n", scenario->name);
+        exit(1);
+    }
+
+    game->jobs = CreateJobSystem(workers);
+
+    if (scenario->setup) {
+        scenario->setup(game);
+    }
+
+    ScenarioResult result = {0};
+    ScenarioResult warmup = {0};
+
+    for (int t = 0; t < scenario->warmup_ticks+scenario->ticks; t++) {
+        Input input = {0};
+
+        if (scenario->before_tick) {
+            scenario->before_tick(game, &input);
+        }
+
+        if (t == scenario->warmup_ticks) {
+            BeginTimedTicks();
+        }
+
+        TimedStep(game, &input, SCENARIO_DELTA_TIME, t < scenario->warmup_ticks ? &warmup : &result);
+    }
+
+    EndTimedTicks(&result);
+    PrintResult(scenario->name, scenario->seed, workers, game, &result, last);
+
+    DestroyJobSystem(game->jobs);
+    DeInitGame(game);
+}
+
+//A recording played back as fast as possible, fails if it no longer matches
+static int RunReplay(const char *path, int workers) {
+    ReplayHeader header;
+    Replay *replay = OpenReplay(path, &header);
+
+    if (replay == NULL) {
+        fprintf(stderr, "%s is not a recording\n", path);
+        return 1;
+    }
+
+    GameData *game = InitNewGame(header.screen_height, header.screen_width, header.max_asteroids, header.max_particles, header.max_missiles, header.seed);
+
+    if (game == NULL || !SetWorldSize(game, header.world_width, header.world_height)) {
+        fprintf(stderr, "out of memory for %s\n", path);
+        CloseReplay(replay);
+        return 1;
+    }
+
+    game->jobs = CreateJobSystem(workers);
+    SetParticleMode(game, header.particle_mode, SCENARIO_DELTA_TIME);
+
+    ScenarioResult result = {0};
+    Input input;
+    float delta_time;
+
+    BeginTimedTicks();
+
+    while (ReplayTick(replay, game, &input, &delta_time)) {
+        TimedStep(game, &input, delta_time, &result);
+    }
+
+    EndTimedTicks(&result);
+
+    long long diverged = ReplayDivergedAt(replay);
+
+    printf("[\n");
+    PrintResult(path, header.seed, workers, game, &result, true);
+    printf("]\n");
+
+    if (diverged >= 0) {
+        fprintf(stderr, "%s diverged from the recording by tick %lld\n", path, diverged);
+    }
+
+    CloseReplay(replay);
+    DestroyJobSystem(game->jobs);
+    DeInitGame(game);
+
+    return diverged >= 0;
+}
+
+static int RunScenarios(const char *name, int workers) {
+    int first = -1;
+    int last = -1;
+
+    for (int i = 0; i < SCENARIO_COUNT; i++) {
+        if (strcmp(name, "all") == 0 || strcmp(name, scenarios[i].name) == 0) {
+            if (first < 0) {
+                first = i;
+            }
+
+            last = i;
+        }
+    }
+
+    if (first < 0) {
+        fprintf(stderr, "no scenario called %s, try one of:", name);
+
+        for (int i = 0; i < SCENARIO_COUNT; i++) {
+            fprintf(stderr, " %s", scenarios[i].name);
+        }
+
+        fprintf(stderr, "\n");
+        return 1;
+    }
+
+    printf("[\n");
+
+    for (int i = first; i <= last; i++) {
+        if (strcmp(name, "all") == 0 || strcmp(name, scenarios[i].name) == 0) {
+            RunScenario(&scenarios[i], workers, i == last);
+        }
+    }
+
+    printf("]\n");
+
+    return 0;
+}
+
+/*
+    A pool sized for count particles, filled and then emptied. Only what is
+    live should be committed, and all of it handed back POOL_IDLE_TRIMS
+    ticks after the last particle goes. Returns the bytes still committed.
+*/
+static size_t BenchPoolMemory(int count) {
+    GameData *game = InitNewGame(600, 800, 20, count, 10, 3);
+    long rss_empty = RssKiB();
+    PoolMemory empty = PoolGetMemory(&game->particles);
+
+    for (int i = 0; i < count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnParticle(game, position, (Vector2){0, 0}, RngRange(&game->rng, 0, 360), 10, 1.0f/144);
+    }
+
+    long rss_full = RssKiB();
+    PoolMemory full = PoolGetMemory(&game->particles);
+
+    PoolDropOldest(&game->particles, count);
+    double start = Seconds();
+
+    for (int t = 0; t < POOL_IDLE_TRIMS; t++) {
+        SweepDeadEntities(game);
+    }
+
+    double elapsed = Seconds()-start;
+    long rss_released = RssKiB();
+    PoolMemory released = PoolGetMemory(&game->particles);
+
+    printf("pool memory  particles %8d  reserved %.1f MB  committed %.1f -> %.1f -> %.1f MB  rss %ld -> %ld -> %ld KiB  %.3f ms/trim\n",
+        count, empty.reserved/1048576.0, empty.committed/1048576.0, full.committed/1048576.0, released.committed/1048576.0,
+        rss_empty, rss_full, rss_released, elapsed*1e3/POOL_IDLE_TRIMS);
+
+    DeInitGame(game);
+    return released.committed;
+}
+
+//Steady, varied play for the snapshot checks, the same from the same state
+static Input SnapshotInput(const GameData *game) {
+    Input input = {0};
+    input.thrust = true;
+    input.fire = game->tick%16 == 0;
+    input.rotate_left = game->tick%200 < 30;
+    return input;
+}
+
+static uint32_t StepAndHash(GameData *game, int ticks) {
+    for (int t = 0; t < ticks; t++) {
+        Input input = SnapshotInput(game);
+        GameStep(game, &input, 1.0f/144);
+    }
+
+    return GameChecksum(game);
+}
+
+/*
+    Snapshots of a game with count particles: the time to take and restore
+    one, and whether a restored game, in place or mapped back in from disk
+    into a new game, plays on exactly as the original did. Returns the
+    number of restores that didn't.
+*/
+static int BenchSnapshot(int count, ParticleMode mode) {
+    int repeats = 20;
+    const char *path = "bench.snap";
+    GameData *game = InitNewGame(600, 800, 2000, count, 64, 21);
+    game->jobs = CreateJobSystem(DefaultWorkerCount());
+    game->invicibility_time = 1e9f;
+
+    for (int i = 0; i < count; i++) {
+        Vector2 position = {RngRange(&game->rng, 0, 800), RngRange(&game->rng, 0, 600)};
+        SpawnParticle(game, position, (Vector2){0, 0}, RngRange(&game->rng, 0, 360), 10, 1.0f/144);
+    }
+
+    SetParticleMode(game, mode, 1.0f/144);
+    StepAndHash(game, 60);
+
+    //the first one allocates the block
+    Snapshot snapshot = {0};
+    TakeSnapshot(&snapshot, game);
+    double start = Seconds();
+
+    for (int r = 0; r < repeats; r++) {
+        TakeSnapshot(&snapshot, game);
+    }
+
+    double take = (Seconds()-start)/repeats;
+    uint32_t expected = StepAndHash(game, 200);
+    int mismatches = 0;
+
+    start = Seconds();
+
+    for (int r = 0; r < repeats; r++) {
+        RestoreSnapshot(game, &snapshot);
+    }
+
+    double restore = (Seconds()-start)/repeats;
+    mismatches += StepAndHash(game, 200) != expected;
+
+    //mapped from disk into a game that has never run
+    GameData *other = InitNewGame(600, 800, 2000, count, 64, 21);
+    Snapshot mapped = {0};
+    double restore_mapped = -1.0;
+
+    if (SaveSnapshot(&snapshot, path) && LoadSnapshot(&mapped, path, true)) {
+        start = Seconds();
+        mismatches += !RestoreSnapshot(other, &mapped);
+        restore_mapped = Seconds()-start;
+        mismatches += StepAndHash(other, 200) != expected;
+    }
+
+    else {
+        printf("could not save and map %s\n", path);
+        mismatches++;
+    }
+
+    printf("snapshot     particles %8d  %-10s  %5.1f MB  take %.3f ms  restore %.3f ms  restore mapped %.3f ms  %s\n",
+        game->particles.count, mode == PARTICLES_ANALYTIC ? "analytic" : "integrated", snapshot.size/1048576.0,
+        take*1e3, restore*1e3, restore_mapped*1e3, mismatches ? "MISMATCH" : "replays the same");
+
+    FreeSnapshot(&mapped);
+    FreeSnapshot(&snapshot);
+    remove(path);
+    DestroyJobSystem(game->jobs);
+    DeInitGame(game);
+    DeInitGame(other);
+
+    return mismatches;
+}
+
+static int RunChecks(const char *draw_dump) {
+    int mismatches = CheckIntegrateKernels(100003);
+
+    if (mismatches > 0) {
+        printf("integrate kernels disagree with UpdatePosition on %d entities\n", mismatches);
+        return 1;
+    }
+
+    int fills[] = {0, 50, 100};
+
+    for (int i = 0; i < 3; i++) {
+        BenchSpawnBurst(1000000, fills[i]);
+    }
+
+    BenchIntegrate(1000000);
+
+    int asteroid_counts[] = {20, 200, 2000, 20000};
+
+    for (int i = 0; i < 4; i++) {
+        BenchAsteroidGrid(asteroid_counts[i], 200);
+    }
+
+    for (int i = 0; i < 4; i++) {
+        BenchAsteroidShapes(asteroid_counts[i]);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        BenchPlayerCollision(asteroid_counts[i]);
+    }
+
+    //only the last, biggest frame is dumped
+    BenchDraw(10000, 200, NULL);
+    BenchDraw(1000000, 2000, draw_dump);
+
+    if (BenchParallelParticles(1000000, 100) > 0) {
+        printf("particle update depends on the number of workers\n");
+        return 1;
+    }
+
+    if (BenchPoolMemory(1000000) > 0) {
+        printf("an empty particle pool kept memory committed\n");
+        return 1;
+    }
+
+    if (BenchSnapshot(1000000, PARTICLES_INTEGRATED) + BenchSnapshot(1000000, PARTICLES_ANALYTIC) > 0) {
+        printf("a restored snapshot played on differently\n");
+        return 1;
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    const char *scenario = NULL;
+    const char *replay = NULL;
+    const char *draw_dump = NULL;
+    int workers = DefaultWorkerCount();
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scenario") == 0 && i+1 < argc) {
+            scenario = argv[++i];
+        }
+
+        else if (strcmp(argv[i], "--replay") == 0 && i+1 < argc) {
+            replay = argv[++i];
+        }
+
+        else if (strcmp(argv[i], "--workers") == 0 && i+1 < argc) {
+            workers = atoi(argv[++i]);
+        }
+
+        else if (strcmp(argv[i], "--draw-dump") == 0 && i+1 < argc) {
+            draw_dump = argv[++i];
+        }
+
+        else {
+            fprintf(stderr, "usage: %s [--scenario all|NAME] [--replay FILE] [--workers N] [--draw-dump FILE]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (replay) {
+        return RunReplay(replay, workers);
+    }
+
+    if (scenario) {
+        return RunScenarios(scenario, workers);
+    }
+
+    return RunChecks(draw_dump);
+}
@@ -0,0 +1,56 @@
+#include <math.h>
+#include "draw.h"
+
+void DrawParticleLines(const GameData *game, float alpha, float trail, Color color) {
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(&game->particles, s, &start);
+
+        for (int i = start; i < start+length; i++) {
+            float segment[4];
+
+            if (ParticleSegment(game, i, alpha, trail, segment)) {
+                RenderLine((Vector2){segment[0], segment[1]}, (Vector2){segment[2], segment[3]}, color);
+            }
+        }
+    }
+}
+
+void DrawAsteroidOutlines(const GameData *game, float alpha, Color color) {
+    Vector2 outline[ASTEROID_GRAPHIC_LENGTH];
+    //the drawn camera trails game->camera by up to a tick of the ship's velocity
+    float slack = fabsf(game->player_velocity.x) + fabsf(game->player_velocity.y);
+
+    for (int r = 0; r < ActiveRunCount(game); r++) {
+        int start;
+        int length = ActiveRun(game, r, &start);
+
+        for (int i = start; i < start+length; i++) {
+            Vector2 position = {game->asteroid_x[i], game->asteroid_y[i]};
+
+            //active chunks reach well past the screen
+            if (!InView(game, position, game->asteroid_radius[game->asteroid_sizes[i]]+slack)) {
+                continue;
+            }
+
+            Vector2 offset = Vec2Scale((Vector2){game->asteroid_vx[i], game->asteroid_vy[i]}, alpha-1);
+
+            for (int p = 0; p < ASTEROID_GRAPHIC_LENGTH; p++) {
+                outline[p] = Vec2Add(game->asteroid_polygons[i*ASTEROID_GRAPHIC_LENGTH+p], offset);
+            }
+
+            RenderLineStrip(outline, ASTEROID_GRAPHIC_LENGTH, color);
+        }
+    }
+}
+
+void DrawMissiles(const GameData *game, float alpha, Color color) {
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(&game->missiles, s, &start);
+
+        for (int i = start; i < start+length; i++) {
+            RenderCircle(RenderPosition(game->missile_positions[i], game->missile_velocities[i], alpha), 1.0f, color);
+        }
+    }
+}
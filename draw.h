@@ -0,0 +1,27 @@
+#ifndef DRAW_H
+#define DRAW_H
+
+/*
+    The parts of the world drawn with plain lines and circles. They only
+    go through render.h, so bench can time them against the null backend.
+*/
+
+#include "game.h"
+#include "render.h"
+
+/*
+    Everything moves by its velocity once per tick, so the position alpha
+    of the way from the previous tick to this one is just a step back along
+    it. Saves keeping a copy of the previous state.
+*/
+static inline Vector2 RenderPosition(Vector2 position, Vector2 velocity, float alpha) {
+    return Vec2Add(position, Vec2Scale(velocity, alpha-1));
+}
+
+//One line per particle, the path the batch replaced
+void DrawParticleLines(const GameData *game, float alpha, float trail, Color color);
+//Only the active asteroids that are on screen. Outlines are moved back along the velocity rather than rebuilt.
+void DrawAsteroidOutlines(const GameData *game, float alpha, Color color);
+void DrawMissiles(const GameData *game, float alpha, Color color);
+
+#endif
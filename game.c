@@ -0,0 +1,1518 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "game.h"
+#include "integrate.h"
+#include "profile.h"
+
+/*
+    Physics Functions
+*/
+
+Vector2 UpdatePosition(Vector2 pos, Vector2 velocity, int screen_width, int screen_height, bool wrap) {
+    Vector2 v = Vec2Add(pos, velocity);
+
+    if (wrap) {
+        //Wrap
+        if (v.x < -15) {
+            v.x += screen_width+15;
+        }
+
+        if (v.y < -15) {
+            v.y = screen_height+15;
+        }
+
+        if (v.x > screen_width+15) {
+            v.x =-15;
+        }
+
+        if (v.y > screen_height+15) {
+            v.y = -15;
+        }
+    }
+
+    return v;
+}
+
+
+Vector2 UpdateVelocity(Vector2 velocity, float acceleration, float rotation, float delta_time) {
+    float to_radians = 0.017453;
+    float r = rotation+90;
+    Vector2 v = velocity;
+    v.x += (acceleration*(-1.0f*cos(r*to_radians)))*delta_time;
+    v.y += (acceleration*(-1.0f*sin(r*to_radians)))*delta_time;
+    return v;
+}
+
+//change_in_degrees indicates how much the object will rotate in 1 second
+float UpdateRotation(float current_rotation, float change_in_degrees, float delta_time) {
+    float rotation = current_rotation+(change_in_degrees*delta_time);
+    //switch to modulo
+
+    if (rotation > 360) {
+        rotation -= 360;
+    }
+
+    if (rotation < 0) {
+        rotation += 360;
+    }
+
+    return rotation;
+}
+
+bool OffScreen(Vector2 v, int screen_width, int screen_height) {
+
+    if (v.x < 0) {
+        return true;
+    }
+
+    if (v.y < 0) {
+        return true;
+    }
+
+    if (v.x > screen_width) {
+        return true;
+    }
+
+    if (v.y > screen_height) {
+        return true;
+    }
+
+    return false;
+}
+
+/*
+    Puts vector graphic points on screen: flips y (graphics are drawn with a
+    bottom left origin), rotates by rotation degrees, scales and translates.
+*/
+void TransformPolygon(const Vector2 *points, int length, float rotation, Vector2 position, float scale, Vector2 *out) {
+    float to_radians = 0.01745f;
+    float c = cosf(rotation*to_radians);
+    float s = sinf(rotation*to_radians);
+
+    for (int i = 0; i < length; i++) {
+        float x = points[i].x;
+        float y = -points[i].y;
+        out[i].x = position.x + (x*c - y*s)*scale;
+        out[i].y = position.y + (x*s + y*c)*scale;
+    }
+}
+
+int ShapeAngle(float rotation) {
+    return (int)floorf(rotation*(SHAPE_ANGLES/360.0f) + 0.5f) & (SHAPE_ANGLES-1);
+}
+
+void PlaceShape(const Vector2 *shape, int length, Vector2 position, Vector2 *out) {
+    for (int i = 0; i < length; i++) {
+        out[i].x = position.x + shape[i].x;
+        out[i].y = position.y + shape[i].y;
+    }
+}
+
+//Furthest any point gets from the origin
+static float BoundingRadius(const Vector2 *points, int length) {
+    float radius = 0.0f;
+
+    for (int i = 0; i < length; i++) {
+        float d = sqrtf(points[i].x*points[i].x + points[i].y*points[i].y);
+
+        if (d > radius) {
+            radius = d;
+        }
+    }
+
+    return radius;
+}
+
+/*
+    Game Functions
+*/
+
+//Sizes the chunks and the collision grid window to world_width and world_height,
+//returns false if out of memory
+static bool InitWorldGrids(GameData *game) {
+    int max_asteroids = game->asteroids.capacity;
+
+    //asteroids wrap 15 pixels past the world edges
+    bool allocated = GridInit(
+        &game->asteroid_chunks,
+        -15, -15,
+        game->world_width+15, game->world_height+15,
+        WORLD_CHUNK_SIZE,
+        max_asteroids
+    );
+
+    int chunks = game->asteroid_chunks.columns*game->asteroid_chunks.rows;
+    game->active_runs = malloc(sizeof(int)*2*(chunks+1));
+    game->moved_runs = malloc(sizeof(int)*2*(chunks+1));
+    allocated = allocated && game->active_runs != NULL && game->moved_runs != NULL;
+    game->active_run_count = 0;
+    game->asteroids_filed = 0;
+
+    //the most chunks the active area can touch across, or the whole world if that is less
+    float span_x = (ceilf((game->screen_width + 2.0f*WORLD_ACTIVE_MARGIN)/WORLD_CHUNK_SIZE)+1)*WORLD_CHUNK_SIZE;
+    float span_y = (ceilf((game->screen_height + 2.0f*WORLD_ACTIVE_MARGIN)/WORLD_CHUNK_SIZE)+1)*WORLD_CHUNK_SIZE;
+    float window_x = fminf(game->world_width+30.0f, span_x);
+    float window_y = fminf(game->world_height+30.0f, span_y);
+
+    allocated = GridInit(
+        &game->asteroid_grid,
+        -15, -15,
+        -15+window_x, -15+window_y,
+        ASTEROID_GRID_CELL_SIZE,
+        max_asteroids
+    ) && allocated;
+
+    return allocated;
+}
+
+static void FreeWorldGrids(GameData *game) {
+    GridFree(&game->asteroid_chunks);
+    GridFree(&game->asteroid_grid);
+    free(game->active_runs);
+    free(game->moved_runs);
+    game->active_runs = NULL;
+    game->moved_runs = NULL;
+}
+
+GameData* InitNewGame(const int screen_height, const int screen_width, int max_asteroids, int max_particles, int max_missiles, unsigned int seed) {
+    //zeroed, so DeInitGame can clean up after a failure part way through
+    GameData *new_game = calloc(1, sizeof(GameData));
+
+    if (new_game == NULL) {
+        return NULL;
+    }
+
+    int largest_pool = max_particles;
+
+    if (max_asteroids > largest_pool) {
+        largest_pool = max_asteroids;
+    }
+
+    if (max_missiles > largest_pool) {
+        largest_pool = max_missiles;
+    }
+
+    Vector2 player_pos;
+    player_pos.x = screen_width/2;
+    player_pos.y = screen_height/2;
+
+    new_game->player_position              = player_pos;
+    new_game->player_velocity              = (Vector2){0.0f, 0.0f};
+    new_game->player_acceleration          = 0.0f;
+    new_game->player_rotation              = 0.0f;
+    new_game->player_rotational_velocity   = 0.0f;
+    new_game->thrusting                    = false;
+    new_game->thrust_time                  = 0;
+    PoolInit(&new_game->asteroids, max_asteroids, POOL_REJECT_WHEN_FULL);
+    new_game->asteroid_x                   = PoolAddColumn(&new_game->asteroids, sizeof(float));
+    new_game->asteroid_y                   = PoolAddColumn(&new_game->asteroids, sizeof(float));
+    new_game->asteroid_vx                  = PoolAddColumn(&new_game->asteroids, sizeof(float));
+    new_game->asteroid_vy                  = PoolAddColumn(&new_game->asteroids, sizeof(float));
+    new_game->asteroid_rotation            = PoolAddColumn(&new_game->asteroids, sizeof(float));
+    new_game->asteroid_rotational_velocity = PoolAddColumn(&new_game->asteroids, sizeof(float));
+    new_game->asteroid_sizes               = PoolAddColumn(&new_game->asteroids, sizeof(int));
+    new_game->asteroid_polygons            = PoolAddColumn(&new_game->asteroids, sizeof(Vector2)*ASTEROID_GRAPHIC_LENGTH);
+    new_game->asteroid_tick                = PoolAddColumn(&new_game->asteroids, sizeof(uint32_t));
+    new_game->asteroid_scratch             = malloc((size_t)PoolWidestColumn(&new_game->asteroids)*max_asteroids);
+    new_game->asteroids_moved              = 0;
+    PoolInit(&new_game->particles, max_particles, POOL_OVERWRITE_OLDEST);
+    new_game->particle_x                   = PoolAddColumn(&new_game->particles, sizeof(float));
+    new_game->particle_y                   = PoolAddColumn(&new_game->particles, sizeof(float));
+    new_game->particle_vx                  = PoolAddColumn(&new_game->particles, sizeof(float));
+    new_game->particle_vy                  = PoolAddColumn(&new_game->particles, sizeof(float));
+    new_game->particle_time                = PoolAddColumn(&new_game->particles, sizeof(float));
+    new_game->particle_spawn_tick          = PoolAddColumn(&new_game->particles, sizeof(uint32_t));
+    new_game->particle_death_tick          = PoolAddColumn(&new_game->particles, sizeof(uint32_t));
+    new_game->particle_flags               = PoolAddColumn(&new_game->particles, 1);
+    new_game->particle_bucket_death        = calloc(ChunkCount(max_particles, PARTICLE_BUCKET_SIZE), sizeof(uint32_t));
+    new_game->particle_mode                = PARTICLES_INTEGRATED;
+    new_game->particle_emission            = 1.0f;
+    PoolInit(&new_game->missiles, max_missiles, POOL_OVERWRITE_OLDEST);
+    new_game->missile_positions            = PoolAddColumn(&new_game->missiles, sizeof(Vector2));
+    new_game->missile_velocities           = PoolAddColumn(&new_game->missiles, sizeof(Vector2));
+    new_game->screen_height                = screen_height;
+    new_game->screen_width                 = screen_width;
+    new_game->world_height                 = screen_height;
+    new_game->world_width                  = screen_width;
+    new_game->camera                       = CameraTarget(new_game, player_pos);
+    new_game->lives                        = 3;
+    new_game->player_cooldown              = 0.0f;
+    new_game->invicibility_time            = 0.0f;
+    new_game->background_rotation          = 0.0f;
+    new_game->background_speed             = (Vector2){10, 30};
+    new_game->events                       = 0;
+    new_game->tick                         = 0;
+    new_game->delta_time                   = 0.0f;
+    new_game->jobs                         = NULL;
+    new_game->grid_candidates              = malloc(sizeof(int)*max_asteroids);
+    new_game->asteroid_hits                = malloc(sizeof(AsteroidDebris)*max_missiles);
+    new_game->chunk_kills                  = malloc(sizeof(int)*ChunkCount(largest_pool, UPDATE_CHUNK_SIZE));
+
+    RngSeedStream(&new_game->rng, seed, RNG_STREAM_GAME);
+    RngSeedStream(&new_game->effects_rng, seed, RNG_STREAM_EFFECTS);
+
+    bool allocated = InitWorldGrids(new_game);
+
+    Vector2 ship_graphic[SHIP_GRAPHIC_LENGTH] = {
+        {0.0f, 12.0f},
+        {10.0f, -10.0f},
+        {0.0f, -5.0f},
+        {-10.0f, -10.0f},
+        {0.0f, 12.0f}
+    };
+
+    Vector2 asteroid_graphic[ASTEROID_GRAPHIC_LENGTH] = {
+        {0, 50},
+        {0, 55},
+        {0, 40},
+        {0, 55},
+        {0, 30},
+        {0, 45},
+        {0, 55},
+        {0, 45},
+        {0, 50}
+    };
+
+    for (int i = 0; i < SHIP_GRAPHIC_LENGTH; i++) {
+        new_game->ship_graphic[i] = ship_graphic[i];
+    }
+
+    for (int i = 0; i < ASTEROID_GRAPHIC_LENGTH; i++) {
+        new_game->asteroid_graphic[i] = Vec2Rotate(asteroid_graphic[i], (45*i)*0.017453);
+    }
+
+    new_game->ship_radius = BoundingRadius(new_game->ship_graphic, SHIP_GRAPHIC_LENGTH);
+
+    for (int size = 1; size <= ASTEROID_MAX_SIZE; size++) {
+        new_game->asteroid_radius[size] = BoundingRadius(new_game->asteroid_graphic, ASTEROID_GRAPHIC_LENGTH)/size;
+    }
+
+    new_game->asteroid_radius[0] = 0.0f;
+    new_game->collision_stats = (CollisionStats){0};
+
+    for (int i = 0; i < PARTICLE_DIRECTIONS; i++) {
+        new_game->particle_directions[i] = UpdateVelocity((Vector2){0, 0}, 1, i*(360.0f/PARTICLE_DIRECTIONS), 1);
+    }
+
+    new_game->shapes = malloc(sizeof(ShapeTables));
+
+    allocated = allocated
+        && !new_game->asteroids.out_of_memory
+        && !new_game->particles.out_of_memory
+        && !new_game->missiles.out_of_memory
+        && new_game->asteroid_scratch != NULL
+        && new_game->particle_bucket_death != NULL
+        && new_game->grid_candidates != NULL
+        && new_game->asteroid_hits != NULL
+        && new_game->chunk_kills != NULL
+        && new_game->shapes != NULL;
+
+    if (!allocated) {
+        DeInitGame(new_game);
+        return NULL;
+    }
+
+    for (int angle = 0; angle < SHAPE_ANGLES; angle++) {
+        float rotation = angle*(360.0f/SHAPE_ANGLES);
+
+        TransformPolygon(
+            new_game->ship_graphic,
+            SHIP_GRAPHIC_LENGTH,
+            rotation,
+            (Vector2){0, 0},
+            1,
+            new_game->shapes->ship[angle]
+        );
+
+        for (int size = 1; size <= ASTEROID_MAX_SIZE; size++) {
+            TransformPolygon(
+                new_game->asteroid_graphic,
+                ASTEROID_GRAPHIC_LENGTH,
+                rotation,
+                (Vector2){0, 0},
+                1/(float)size,
+                new_game->shapes->asteroid[size][angle]
+            );
+        }
+    }
+
+    return new_game;
+}
+
+void DeInitGame(GameData *game) {
+    PoolFree(&game->asteroids);
+    PoolFree(&game->particles);
+    PoolFree(&game->missiles);
+    free(game->particle_bucket_death);
+    free(game->chunk_kills);
+    free(game->grid_candidates);
+    free(game->asteroid_hits);
+    free(game->shapes);
+    free(game->asteroid_scratch);
+    FreeWorldGrids(game);
+    free(game);
+}
+
+bool SetWorldSize(GameData *game, int width, int height) {
+    FreeWorldGrids(game);
+    game->world_width = width;
+    game->world_height = height;
+
+    if (!InitWorldGrids(game)) {
+        return false;
+    }
+
+    game->player_position = (Vector2){width/2, height/2};
+    game->camera = CameraTarget(game, game->player_position);
+    return true;
+}
+
+//Clamps one axis of the camera, a world no wider than the screen stays centred
+static float CameraAxis(float focus, int screen_size, int world_size) {
+    float half = screen_size*0.5f;
+
+    if (world_size <= screen_size) {
+        return world_size*0.5f;
+    }
+
+    if (focus < half) {
+        return half;
+    }
+
+    if (focus > world_size-half) {
+        return world_size-half;
+    }
+
+    return focus;
+}
+
+Vector2 CameraTarget(const GameData *game, Vector2 focus) {
+    return (Vector2){
+        CameraAxis(focus.x, game->screen_width, game->world_width),
+        CameraAxis(focus.y, game->screen_height, game->world_height)
+    };
+}
+
+void SpawnMissile(GameData *game, Vector2 position, float rotation, float acceleration, float delta_time) {
+    //overwrites the oldest missile when full
+    int index = PoolPush(&game->missiles);
+
+    if (index < 0) {
+        return;
+    }
+
+    game->missile_positions[index] = position;
+
+    game->missile_velocities[index] = UpdateVelocity(
+        (Vector2){0, 0},
+        acceleration,
+        rotation,
+        delta_time
+    );
+}
+
+//Chance an old particle dies each tick, what GetRandomValue(0, 1000) < 10 used to give
+#define PARTICLE_DEATH_CHANCE (10/1001.0f)
+
+//Furthest ahead a death tick is set, well inside the 32 bit wrap
+#define PARTICLE_MAX_LIFETIME (1 << 28)
+
+//Updates after which position+n*velocity is past 0 or size, as OffScreen sees it
+static float UpdatesUntilOffScreen(float position, float velocity, float size) {
+    float updates = INFINITY;
+
+    if (velocity > 0) {
+        updates = floorf((size-position)/velocity)+1;
+    }
+
+    else if (velocity < 0) {
+        updates = floorf(position/-velocity)+1;
+    }
+
+    else if (position < 0 || position > size) {
+        updates = 1;
+    }
+
+    return updates < 1 ? 1 : updates;
+}
+
+/*
+    Updates until the particle in slot dies, the same odds KillParticles
+    gives it: off screen, or a PARTICLE_DEATH_CHANCE every update once its
+    time passes PARTICLE_OLD_AGE. time is how old it is now.
+*/
+static int ParticleLifetime(GameData *game, Rng *rng, int slot, float time) {
+    float x_updates = UpdatesUntilOffScreen(game->particle_x[slot], game->particle_vx[slot], game->world_width);
+    float y_updates = UpdatesUntilOffScreen(game->particle_y[slot], game->particle_vy[slot], game->world_height);
+    float updates = x_updates < y_updates ? x_updates : y_updates;
+
+    //the first update it is old on, then however many rolls it survives
+    float old = 1;
+
+    if (time <= PARTICLE_OLD_AGE) {
+        old = game->delta_time > 0 ? floorf((PARTICLE_OLD_AGE-time)/game->delta_time)+1 : INFINITY;
+    }
+
+    float roll = 1.0f-RngFloat(rng, 0, 1);
+    float survived = floorf(logf(roll)/log1pf(-PARTICLE_DEATH_CHANCE));
+
+    if (old+survived < updates) {
+        updates = old+survived;
+    }
+
+    return updates < PARTICLE_MAX_LIFETIME ? (int)updates : PARTICLE_MAX_LIFETIME;
+}
+
+//Sets the clocks of count analytic particles starting at slot, all of age time
+static void StartParticleClocks(GameData *game, int slot, int count, float time) {
+    Rng rng = game->effects_rng;
+    uint32_t now = (uint32_t)game->tick;
+    int capacity = game->particles.capacity;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t death = now + ParticleLifetime(game, &rng, slot, time);
+        uint32_t *bucket = &game->particle_bucket_death[slot/PARTICLE_BUCKET_SIZE];
+
+        game->particle_spawn_tick[slot] = now;
+        game->particle_death_tick[slot] = death;
+
+        if (TicksUntil(*bucket, death) > 0) {
+            *bucket = death;
+        }
+
+        if (++slot == capacity) {
+            slot = 0;
+        }
+    }
+
+    game->effects_rng = rng;
+}
+
+void SpawnParticle(GameData *game, Vector2 position, Vector2 initial_velocity, float rotation, float acceleration, float delta_time) {
+    //overwrites the oldest particle when full
+    int index = PoolPush(&game->particles);
+
+    if (index < 0) {
+        return;
+    }
+
+    Vector2 velocity = UpdateVelocity(
+        initial_velocity,
+        acceleration,
+        rotation,
+        delta_time
+    );
+
+    game->particle_x[index] = position.x;
+    game->particle_y[index] = position.y;
+    game->particle_vx[index] = velocity.x;
+    game->particle_vy[index] = velocity.y;
+    game->particle_time[index] = 0.0f;
+
+    if (game->particle_mode == PARTICLES_ANALYTIC) {
+        StartParticleClocks(game, index, 1, 0.0f);
+    }
+}
+
+void SpawnParticleBurst(GameData *game, const ParticleEmitter *emitter, float delta_time) {
+    int wanted = emitter->count;
+
+    //rounded at random so a one particle emitter still fires that often on average
+    if (game->particle_emission < 1.0f) {
+        wanted = (int)(wanted*game->particle_emission + RngFloat(&game->effects_rng, 0, 1));
+    }
+
+    int first;
+    int count = PoolPushMany(&game->particles, wanted, &first);
+    int slot = first;
+    int capacity = game->particles.capacity;
+    //locals so the stores below can't make the compiler reload any of this
+    ParticleEmitter e = *emitter;
+    Rng rng = game->effects_rng;
+    const Vector2 *directions = game->particle_directions;
+    float *x = game->particle_x;
+    float *y = game->particle_y;
+    float *vx = game->particle_vx;
+    float *vy = game->particle_vy;
+    float *time = game->particle_time;
+    float to_index = PARTICLE_DIRECTIONS/360.0f;
+    bool spread_out = e.area.x != 0.0f || e.area.y != 0.0f;
+
+    for (int i = 0; i < count; i++) {
+        float angle = RngFloat(&rng, e.angle-e.spread, e.angle+e.spread);
+        float speed = RngFloat(&rng, e.min_speed, e.max_speed);
+
+        if (e.fast_chance > 0.0f) {
+            //a select rather than a branch, it would be mispredicted half the time
+            bool fast = RngFloat(&rng, 0, 1) < e.fast_chance;
+            speed = fast ? e.fast_speed : speed;
+        }
+
+        //nearest table entry, shifted up four turns so truncating rounds the same for negative angles
+        int direction = (int)(angle*to_index + 0.5f + 4*PARTICLE_DIRECTIONS) & (PARTICLE_DIRECTIONS-1);
+        Vector2 unit = directions[direction];
+
+        x[slot] = e.position.x;
+        y[slot] = e.position.y;
+
+        if (spread_out) {
+            x[slot] += RngFloat(&rng, 0, e.area.x);
+            y[slot] += RngFloat(&rng, 0, e.area.y);
+        }
+
+        vx[slot] = e.velocity.x + unit.x*speed*delta_time;
+        vy[slot] = e.velocity.y + unit.y*speed*delta_time;
+        time[slot] = 0.0f;
+
+        if (++slot == capacity) {
+            slot = 0;
+        }
+    }
+
+    game->effects_rng = rng;
+
+    if (game->particle_mode == PARTICLES_ANALYTIC) {
+        StartParticleClocks(game, first, count, 0.0f);
+    }
+}
+
+void TransformAsteroid(GameData *game, int index) {
+    int size = game->asteroid_sizes[index];
+    int angle = ShapeAngle(game->asteroid_rotation[index]);
+
+    PlaceShape(
+        game->shapes->asteroid[size][angle],
+        ASTEROID_GRAPHIC_LENGTH,
+        (Vector2){game->asteroid_x[index], game->asteroid_y[index]},
+        &game->asteroid_polygons[index*ASTEROID_GRAPHIC_LENGTH]
+    );
+}
+
+void SpawnAsteroid(GameData *game, int size, Vector2 position, float rotation, float acceleration, float delta_time) {
+    int index = PoolPush(&game->asteroids);
+
+    if (index >= 0) {
+        Vector2 velocity = UpdateVelocity(
+            (Vector2){0, 0},
+            acceleration,
+            rotation,
+            delta_time
+        );
+
+        game->asteroid_x[index] = position.x;
+        game->asteroid_y[index] = position.y;
+        game->asteroid_vx[index] = velocity.x;
+        game->asteroid_vy[index] = velocity.y;
+        game->asteroid_rotation[index] = rotation;
+        game->asteroid_sizes[index] = size;
+        game->asteroid_tick[index] = game->asteroids_moved;
+        TransformAsteroid(game, index);
+        game->asteroid_rotational_velocity[index] = RngRange(&game->rng, -90*size, 90*size);
+    }
+}
+
+//Spawns the debris particles and child asteroids of a destroyed asteroid
+static void BreakAsteroid(GameData *game, AsteroidDebris debris, float delta_time) {
+    int asteroid_size = debris.size;
+    Vector2 pos = debris.position;
+    Vector2 velocity = debris.velocity;
+
+    //Spawn particles, fanned out to one side
+    ParticleEmitter debris_burst = {
+        .position  = pos,
+        .velocity  = velocity,
+        .angle     = RngRange(&game->rng, 0, 360),
+        .spread    = 22*asteroid_size,
+        .min_speed = 10,
+        .max_speed = 500/asteroid_size,
+        .count     = 100/asteroid_size
+    };
+
+    SpawnParticleBurst(game, &debris_burst, delta_time);
+
+    //Spawn new asteroids if not the smallest asteroid size
+    if (asteroid_size < 4) {
+        for (int i = 0; i < 2; i++) {
+            SpawnAsteroid(
+                game,
+                asteroid_size+2,
+                pos,
+                RngRange(&game->rng, 0, 360),
+                RngRange(&game->rng, 30, 100)*asteroid_size,
+                delta_time
+            );
+        }
+    }
+}
+
+//Kills an asteroid and returns what BreakAsteroid needs, the slot may be reused right after
+static AsteroidDebris KillAsteroid(GameData *game, int index) {
+    AsteroidDebris debris = {
+        {game->asteroid_x[index], game->asteroid_y[index]},
+        {game->asteroid_vx[index]*0.5f, game->asteroid_vy[index]*0.5f},
+        game->asteroid_sizes[index]
+    };
+
+    //removed from the array by SweepDeadEntities at the end of the tick
+    PoolKill(&game->asteroids, index);
+
+    return debris;
+}
+
+void DestroyAsteroid(GameData *game, int index, float delta_time) {
+    BreakAsteroid(game, KillAsteroid(game, index), delta_time);
+}
+
+/*
+    Updates
+*/
+
+typedef struct UpdateJob {
+    GameData *game;
+    float delta_time;
+    //drawn from game->effects_rng once per tick, each chunk derives its own stream
+    uint32_t seed;
+    //slot of element 0, for work that doesn't start at the first slot
+    int first;
+} UpdateJob;
+
+static void UpdateAsteroidChunk(void *data, int begin, int end, int chunk) {
+    UpdateJob *job = data;
+    GameData *game = job->game;
+    uint32_t now = (uint32_t)game->tick;
+    //every asteroid only one tick behind, as when all of them are active
+    bool in_step = true;
+    (void)chunk;
+
+    begin += job->first;
+    end += job->first;
+
+    for (int i = begin; i < end; i++) {
+        int behind = TicksUntil(game->asteroid_tick[i], now);
+        float rotation = UpdateRotation(
+            game->asteroid_rotation[i],
+            game->asteroid_rotational_velocity[i],
+            job->delta_time*behind
+        );
+
+        //a long sleep can turn it more than once
+        if (rotation < 0 || rotation > 360) {
+            rotation = fmodf(rotation, 360);
+            rotation += rotation < 0 ? 360 : 0;
+        }
+
+        game->asteroid_rotation[i] = rotation;
+        in_step = in_step && behind == 1;
+    }
+
+    if (in_step) {
+        IntegrateWrapped(
+            game->asteroid_x+begin,
+            game->asteroid_y+begin,
+            game->asteroid_vx+begin,
+            game->asteroid_vy+begin,
+            end-begin,
+            game->world_width,
+            game->world_height
+        );
+    }
+
+    else {
+        //straight lines, so the ticks slept through are one longer step
+        for (int i = begin; i < end; i++) {
+            int behind = TicksUntil(game->asteroid_tick[i], now);
+
+            Vector2 position = UpdatePosition(
+                (Vector2){game->asteroid_x[i], game->asteroid_y[i]},
+                Vec2Scale((Vector2){game->asteroid_vx[i], game->asteroid_vy[i]}, behind),
+                game->world_width,
+                game->world_height,
+                true
+            );
+
+            game->asteroid_x[i] = position.x;
+            game->asteroid_y[i] = position.y;
+        }
+    }
+
+    for (int i = begin; i < end; i++) {
+        game->asteroid_tick[i] = now;
+        TransformAsteroid(game, i);
+    }
+}
+
+//Ticks between moves for the chunks in each tier, see ChunkTier
+static const int chunk_periods[] = {1, WORLD_NEAR_PERIOD, WORLD_FAR_PERIOD};
+
+//First and last column, then first and last row, of the active chunks
+static void ActiveChunks(const GameData *game, int bounds[4]) {
+    const SpatialGrid *chunks = &game->asteroid_chunks;
+    Vector2 origin = ViewOrigin(game);
+    float left = origin.x - WORLD_ACTIVE_MARGIN - chunks->origin_x;
+    float top = origin.y - WORLD_ACTIVE_MARGIN - chunks->origin_y;
+    float right = left + game->screen_width + 2*WORLD_ACTIVE_MARGIN;
+    float bottom = top + game->screen_height + 2*WORLD_ACTIVE_MARGIN;
+    float edges[4] = {left, right, top, bottom};
+
+    for (int e = 0; e < 4; e++) {
+        int last = e < 2 ? chunks->columns-1 : chunks->rows-1;
+        int chunk = (int)floorf(edges[e]/chunks->cell_size);
+        bounds[e] = chunk < 0 ? 0 : chunk > last ? last : chunk;
+    }
+}
+
+//Chunks from index to the nearest of first..last, going round the way the world wraps
+static int ChunkDistance(int index, int first, int last, int count) {
+    if (index >= first && index <= last) {
+        return 0;
+    }
+
+    int after = (index-last+count)%count;
+    int before = (first-index+count)%count;
+    return after < before ? after : before;
+}
+
+//0 for an active chunk, 1 for the ring around them, 2 for the rest
+static int ChunkTier(const GameData *game, const int bounds[4], int column, int row) {
+    int dx = ChunkDistance(column, bounds[0], bounds[1], game->asteroid_chunks.columns);
+    int dy = ChunkDistance(row, bounds[2], bounds[3], game->asteroid_chunks.rows);
+    int distance = dx > dy ? dx : dy;
+
+    return distance < 2 ? distance : 2;
+}
+
+/*
+    Writes begin, end pairs of the filed slots in every active chunk, plus
+    the chunks due to move this tick if moving, merging runs that touch.
+    Chunks take turns so the sleeping ones don't all wake on one tick.
+*/
+static int ChunkRuns(const GameData *game, bool moving, int *runs) {
+    const SpatialGrid *chunks = &game->asteroid_chunks;
+    const int *start = chunks->cell_start;
+    int bounds[4];
+    int run_count = 0;
+
+    ActiveChunks(game, bounds);
+
+    for (int row = 0; row < chunks->rows; row++) {
+        for (int column = 0; column < chunks->columns; column++) {
+            int c = row*chunks->columns + column;
+            int period = chunk_periods[ChunkTier(game, bounds, column, row)];
+            bool wanted = period == 1 || (moving && ((game->tick+c) & (period-1)) == 0);
+
+            if (!wanted || start[c] == start[c+1]) {
+                continue;
+            }
+
+            if (run_count > 0 && runs[run_count*2-1] == start[c]) {
+                runs[run_count*2-1] = start[c+1];
+            }
+
+            else {
+                runs[run_count*2] = start[c];
+                runs[run_count*2+1] = start[c+1];
+                run_count++;
+            }
+        }
+    }
+
+    return run_count;
+}
+
+void UpdateAsteroids(GameData *game, float delta_time) {
+    int *runs = game->moved_runs;
+    int run_count = ChunkRuns(game, true, runs);
+
+    //unfiled asteroids move every tick
+    if (run_count > 0 && runs[run_count*2-1] == game->asteroids_filed) {
+        runs[run_count*2-1] = game->asteroids.count;
+    }
+
+    else {
+        runs[run_count*2] = game->asteroids_filed;
+        runs[run_count*2+1] = game->asteroids.count;
+        run_count++;
+    }
+
+    for (int r = 0; r < run_count; r++) {
+        UpdateJob job = {game, delta_time, 0, runs[r*2]};
+        ParallelFor(game->jobs, runs[r*2+1]-runs[r*2], UPDATE_CHUNK_SIZE, UpdateAsteroidChunk, &job);
+    }
+
+    game->asteroids_moved = (uint32_t)game->tick;
+}
+
+//Kills particles in slots [start, start+length) from the flags IntegrateParticles set
+static int KillParticles(GameData *game, Rng *rng, int start, int length) {
+    int kills = 0;
+
+    for (int index = start; index < start+length; index++) {
+        unsigned char flags = game->particle_flags[index];
+
+        if (flags == 0) {
+            continue;
+        }
+
+        bool offscreen = flags & INTEGRATE_OFFSCREEN;
+
+        //Also kill if too old
+        if (flags & INTEGRATE_OLD) {
+
+            if (RngFloat(rng, 0, 1) < PARTICLE_DEATH_CHANCE) {
+                offscreen = true;
+            }
+        }
+
+        if (offscreen) {
+            PoolMarkDead(&game->particles, index);
+            kills++;
+        }
+    }
+
+    return kills;
+}
+
+//begin and end are ring positions, the slots they cover may wrap around
+static void UpdateParticleChunk(void *data, int begin, int end, int chunk) {
+    UpdateJob *job = data;
+    GameData *game = job->game;
+    EntityPool *pool = &game->particles;
+    Rng rng;
+    RngSeedStream(&rng, job->seed, chunk);
+
+    int slot = PoolSlot(pool, begin);
+    int remaining = end-begin;
+    int kills = 0;
+
+    while (remaining > 0) {
+        int run = remaining;
+
+        if (slot+run > pool->capacity) {
+            run = pool->capacity-slot;
+        }
+
+        IntegrateParticles(
+            game->particle_x+slot,
+            game->particle_y+slot,
+            game->particle_vx+slot,
+            game->particle_vy+slot,
+            game->particle_time+slot,
+            game->particle_flags+slot,
+            run,
+            job->delta_time,
+            PARTICLE_OLD_AGE,
+            game->world_width,
+            game->world_height
+        );
+
+        //kill while the chunk is still in cache
+        kills += KillParticles(game, &rng, slot, run);
+
+        slot = 0;
+        remaining -= run;
+    }
+
+    game->chunk_kills[chunk] = kills;
+}
+
+/*
+    Drops the oldest bucket of analytic particles for as long as everything
+    ever written to it has expired. A long lived particle holds up the rest
+    of the pool behind it, the draw pass skips whatever expired meanwhile.
+*/
+static void DropExpiredParticles(GameData *game) {
+    EntityPool *pool = &game->particles;
+    uint32_t now = (uint32_t)game->tick;
+
+    while (pool->count > 0) {
+        int bucket = pool->head/PARTICLE_BUCKET_SIZE;
+        int bucket_end = (bucket+1)*PARTICLE_BUCKET_SIZE;
+
+        if (bucket_end > pool->capacity) {
+            bucket_end = pool->capacity;
+        }
+
+        if (TicksUntil(now, game->particle_bucket_death[bucket]) > 0) {
+            break;
+        }
+
+        //everything in it is dead, whatever gets written there next starts afresh
+        game->particle_bucket_death[bucket] = now;
+        PoolDropOldest(pool, bucket_end-pool->head);
+    }
+}
+
+void UpdateParticles(GameData *game, float delta_time) {
+    if (game->particle_mode == PARTICLES_ANALYTIC) {
+        DropExpiredParticles(game);
+        return;
+    }
+
+    UpdateJob job = {game, delta_time, RngNext(&game->effects_rng), 0};
+    int count = game->particles.count;
+
+    ParallelFor(game->jobs, count, UPDATE_CHUNK_SIZE, UpdateParticleChunk, &job);
+
+    for (int c = 0; c < ChunkCount(count, UPDATE_CHUNK_SIZE); c++) {
+        PoolAddDead(&game->particles, game->chunk_kills[c]);
+    }
+}
+
+static void UpdateMissileChunk(void *data, int begin, int end, int chunk) {
+    UpdateJob *job = data;
+    GameData *game = job->game;
+    Vector2 origin = ViewOrigin(game);
+    int kills = 0;
+
+    for (int position = begin; position < end; position++) {
+        int i = PoolSlot(&game->missiles, position);
+
+        game->missile_positions[i] = UpdatePosition(
+            game->missile_positions[i],
+            game->missile_velocities[i],
+            game->world_width,
+            game->world_height,
+            false
+        );
+
+        if (OffScreen(Vec2Subtract(game->missile_positions[i], origin), game->screen_width, game->screen_height)) {
+            PoolMarkDead(&game->missiles, i);
+            kills++;
+        }
+    }
+
+    game->chunk_kills[chunk] = kills;
+}
+
+void UpdateMissiles(GameData *game) {
+    UpdateJob job = {game, 0.0f, 0, 0};
+    int count = game->missiles.count;
+
+    ParallelFor(game->jobs, count, UPDATE_CHUNK_SIZE, UpdateMissileChunk, &job);
+
+    for (int c = 0; c < ChunkCount(count, UPDATE_CHUNK_SIZE); c++) {
+        PoolAddDead(&game->missiles, game->chunk_kills[c]);
+    }
+}
+
+void SetParticleMode(GameData *game, ParticleMode mode, float delta_time) {
+    EntityPool *pool = &game->particles;
+    uint32_t now = (uint32_t)game->tick;
+    game->delta_time = delta_time;
+
+    if (mode == game->particle_mode) {
+        return;
+    }
+
+    if (mode == PARTICLES_ANALYTIC) {
+        int buckets = ChunkCount(pool->capacity, PARTICLE_BUCKET_SIZE);
+
+        for (int b = 0; b < buckets; b++) {
+            game->particle_bucket_death[b] = now;
+        }
+    }
+
+    for (int position = 0; position < pool->count; position++) {
+        int i = PoolSlot(pool, position);
+
+        if (mode == PARTICLES_ANALYTIC) {
+            //roll its death from here, then wind it back to where it spawned
+            float age = delta_time > 0 ? roundf(game->particle_time[i]/delta_time) : 0;
+            StartParticleClocks(game, i, 1, game->particle_time[i]);
+            game->particle_spawn_tick[i] = now-(uint32_t)age;
+            game->particle_x[i] -= game->particle_vx[i]*age;
+            game->particle_y[i] -= game->particle_vy[i]*age;
+        }
+
+        else {
+            uint32_t age = now-game->particle_spawn_tick[i];
+            game->particle_x[i] += game->particle_vx[i]*age;
+            game->particle_y[i] += game->particle_vy[i]*age;
+            game->particle_time[i] = age*delta_time;
+
+            if (TicksUntil(now, game->particle_death_tick[i]) <= 0) {
+                PoolKill(pool, i);
+            }
+        }
+    }
+
+    game->particle_mode = mode;
+    PoolSweep(pool);
+}
+
+void CopyGameFields(GameData *dst, const GameData *src) {
+    GameData own = *dst;
+    *dst = *src;
+
+    //everything dst allocated stays its own
+    dst->asteroids                    = own.asteroids;
+    dst->asteroid_x                   = own.asteroid_x;
+    dst->asteroid_y                   = own.asteroid_y;
+    dst->asteroid_vx                  = own.asteroid_vx;
+    dst->asteroid_vy                  = own.asteroid_vy;
+    dst->asteroid_rotation            = own.asteroid_rotation;
+    dst->asteroid_rotational_velocity = own.asteroid_rotational_velocity;
+    dst->asteroid_sizes               = own.asteroid_sizes;
+    dst->asteroid_polygons            = own.asteroid_polygons;
+    dst->asteroid_tick                = own.asteroid_tick;
+    dst->asteroid_chunks              = own.asteroid_chunks;
+    dst->active_runs                  = own.active_runs;
+    dst->moved_runs                   = own.moved_runs;
+    dst->asteroid_scratch             = own.asteroid_scratch;
+    dst->asteroid_grid                = own.asteroid_grid;
+    dst->grid_candidates              = own.grid_candidates;
+    dst->asteroid_hits                = own.asteroid_hits;
+    dst->particles                    = own.particles;
+    dst->particle_x                   = own.particle_x;
+    dst->particle_y                   = own.particle_y;
+    dst->particle_vx                  = own.particle_vx;
+    dst->particle_vy                  = own.particle_vy;
+    dst->particle_time                = own.particle_time;
+    dst->particle_flags               = own.particle_flags;
+    dst->particle_spawn_tick          = own.particle_spawn_tick;
+    dst->particle_death_tick          = own.particle_death_tick;
+    dst->particle_bucket_death        = own.particle_bucket_death;
+    dst->missiles                     = own.missiles;
+    dst->missile_positions            = own.missile_positions;
+    dst->missile_velocities           = own.missile_velocities;
+    dst->shapes                       = own.shapes;
+    dst->jobs                         = own.jobs;
+    dst->chunk_kills                  = own.chunk_kills;
+}
+
+bool CopyGameState(GameData *dst, const GameData *src) {
+    CopyGameFields(dst, src);
+
+    bool asteroids_copied = PoolCopy(&dst->asteroids, &src->asteroids);
+    bool copied = PoolCopy(&dst->particles, &src->particles);
+    copied = PoolCopy(&dst->missiles, &src->missiles) && copied;
+
+    //views never sweep, so give back what src has given back here
+    PoolTrim(&dst->asteroids);
+    PoolTrim(&dst->particles);
+    PoolTrim(&dst->missiles);
+
+    if (!asteroids_copied) {
+        dst->asteroids_filed = 0;
+        dst->active_run_count = 0;
+        return false;
+    }
+
+    //asteroids are never in the ring's second segment, so the runs still hold
+    int chunks = src->asteroid_chunks.columns*src->asteroid_chunks.rows;
+    memcpy(dst->asteroid_chunks.cell_start, src->asteroid_chunks.cell_start, sizeof(int)*(chunks+1));
+    memcpy(dst->active_runs, src->active_runs, sizeof(int)*2*src->active_run_count);
+    return copied;
+}
+
+//Moves every chunk's run down past the dead asteroids before it, ahead of the sweep
+static void SweepAsteroidChunks(GameData *game) {
+    EntityPool *pool = &game->asteroids;
+    SpatialGrid *chunks = &game->asteroid_chunks;
+    int *start = chunks->cell_start;
+    int cells = chunks->columns*chunks->rows;
+    int removed = 0;
+    int i = 0;
+
+    if (pool->dead_count == 0 || game->asteroids_filed == 0) {
+        return;
+    }
+
+    for (int c = 0; c < cells; c++) {
+        int end = start[c+1];
+        start[c] -= removed;
+
+        for (; i < end; i++) {
+            removed += PoolIsDead(pool, PoolSlot(pool, i));
+        }
+    }
+
+    start[cells] -= removed;
+    game->asteroids_filed -= removed;
+}
+
+void SweepDeadEntities(GameData *game) {
+    SweepAsteroidChunks(game);
+    PoolSweep(&game->asteroids);
+    PoolSweep(&game->particles);
+    PoolSweep(&game->missiles);
+    PoolTrim(&game->asteroids);
+    PoolTrim(&game->particles);
+    PoolTrim(&game->missiles);
+}
+
+PoolMemory GameMemory(const GameData *game) {
+    const EntityPool *pools[] = {&game->asteroids, &game->particles, &game->missiles};
+    PoolMemory total = {0};
+
+    for (int p = 0; p < 3; p++) {
+        PoolMemory memory = PoolGetMemory(pools[p]);
+        total.reserved += memory.reserved;
+        total.committed += memory.committed;
+        total.peak_committed += memory.peak_committed;
+        total.live += memory.live;
+    }
+
+    return total;
+}
+
+void FileAsteroids(GameData *game) {
+    EntityPool *pool = &game->asteroids;
+    SpatialGrid *chunks = &game->asteroid_chunks;
+
+    //entries comes out in chunk order and cell_start is where each chunk begins
+    GridBuild(chunks, game->asteroid_x, game->asteroid_y, pool->count);
+
+    //one chunk is already in order
+    if (chunks->columns*chunks->rows > 1) {
+        PoolReorder(pool, chunks->entries, game->asteroid_scratch);
+    }
+
+    game->asteroids_filed = pool->count;
+}
+
+void FindActiveAsteroids(GameData *game) {
+    game->active_run_count = ChunkRuns(game, false, game->active_runs);
+}
+
+void BuildAsteroidGrid(GameData *game) {
+    SpatialGrid *grid = &game->asteroid_grid;
+    const SpatialGrid *chunks = &game->asteroid_chunks;
+    int bounds[4];
+
+    //the window starts at the first active chunk, kept inside the world
+    ActiveChunks(game, bounds);
+    float right = chunks->origin_x + chunks->columns*chunks->cell_size;
+    float bottom = chunks->origin_y + chunks->rows*chunks->cell_size;
+    grid->origin_x = fminf(chunks->origin_x + bounds[0]*chunks->cell_size, right - grid->columns*grid->cell_size);
+    grid->origin_y = fminf(chunks->origin_y + bounds[2]*chunks->cell_size, bottom - grid->rows*grid->cell_size);
+    grid->origin_x = fmaxf(grid->origin_x, chunks->origin_x);
+    grid->origin_y = fmaxf(grid->origin_y, chunks->origin_y);
+
+    //the unfiled asteroids go in as one more run, active_runs has room for it
+    int run_count = game->active_run_count;
+    game->active_runs[run_count*2] = game->asteroids_filed;
+    game->active_runs[run_count*2+1] = game->asteroids.count;
+
+    GridBuildRuns(grid, game->asteroid_x, game->asteroid_y, game->active_runs, run_count+1);
+}
+
+bool CheckMissileCollisions(GameData *game, float delta_time) {
+    int asteroid_radius = 50;
+    int missile_radius = 8;
+    int hits = 0;
+
+    //Find every hit first, nothing is spawned until all missiles are checked
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(&game->missiles, s, &start);
+
+        for (int i = start; i < start+length; i++) {
+
+            if (PoolIsDead(&game->missiles, i)) {
+                continue;
+            }
+
+            Vector2 missile_pos = game->missile_positions[i];
+            int candidates = GridQuery(
+                &game->asteroid_grid,
+                missile_pos.x,
+                missile_pos.y,
+                missile_radius+asteroid_radius,
+                game->grid_candidates
+            );
+
+            //the lowest index wins when a missile touches several asteroids
+            int hit = -1;
+
+            for (int c = 0; c < candidates; c++) {
+                int j = game->grid_candidates[c];
+
+                if (PoolIsDead(&game->asteroids, j) || (hit >= 0 && j > hit)) {
+                    continue;
+                }
+
+                Vector2 aster_pos = {game->asteroid_x[j], game->asteroid_y[j]};
+                int asteroid_size = game->asteroid_sizes[j];
+
+                if (CirclesOverlap(missile_pos, missile_radius, aster_pos, asteroid_radius/asteroid_size)) {
+                    hit = j;
+                }
+            }
+
+            if (hit >= 0) {
+                PoolKill(&game->missiles, i);
+                game->asteroid_hits[hits++] = KillAsteroid(game, hit);
+            }
+        }
+    }
+
+    for (int h = 0; h < hits; h++) {
+        BreakAsteroid(game, game->asteroid_hits[h], delta_time);
+    }
+
+    return hits > 0;
+}
+
+bool CheckPlayerCollision(GameData *game, float delta_time) {
+    CollisionStats *stats = &game->collision_stats;
+    Vector2 player_pos = game->player_position;
+
+    int candidates = GridQuery(
+        &game->asteroid_grid,
+        player_pos.x,
+        player_pos.y,
+        game->ship_radius+game->asteroid_radius[1],
+        game->grid_candidates
+    );
+
+    stats->candidates += candidates;
+
+    //the lowest index wins when the ship touches several asteroids
+    int hit = -1;
+
+    for (int c = 0; c < candidates; c++) {
+        int i = game->grid_candidates[c];
+
+        if (PoolIsDead(&game->asteroids, i) || (hit >= 0 && i > hit)) {
+            continue;
+        }
+
+        Vector2 asteroid_pos = {game->asteroid_x[i], game->asteroid_y[i]};
+        float asteroid_radius = game->asteroid_radius[game->asteroid_sizes[i]];
+
+        //cannot touch if the bounding circles do not
+        if (!CirclesOverlap(player_pos, game->ship_radius, asteroid_pos, asteroid_radius)) {
+            stats->bounding_rejects++;
+            continue;
+        }
+
+        stats->exact_tests++;
+        const Vector2 *asteroid_polygon = &game->asteroid_polygons[i*ASTEROID_GRAPHIC_LENGTH];
+
+        //Check collision of points in players ship against asteroid polygon
+        for (int j = 0; j < SHIP_GRAPHIC_LENGTH; j++) {
+
+            if (PointInPoly(game->ship_polygon[j], asteroid_polygon, ASTEROID_GRAPHIC_LENGTH)) {
+                hit = i;
+                break;
+            }
+        }
+
+    }
+
+    if (hit >= 0) {
+        DestroyAsteroid(game, hit, delta_time);
+        return true;
+    }
+
+    return false;
+}
+
+/*
+    Step
+*/
+
+static void SpawnAsteroidWave(GameData *game) {
+    int asteroids_to_spawn = game->asteroids.capacity/3;
+
+    while (asteroids_to_spawn > 0) {
+        //find a location greater than 70 pixels from player
+        Vector2 apos = {
+            RngRange(&game->rng, 0, game->world_width),
+            RngRange(&game->rng, 0, game->world_height)
+        };
+
+        float distance = Vec2Distance(game->player_position, apos);
+
+        if (distance < 70) {
+            continue;
+        }
+
+        SpawnAsteroid(
+            game,
+            1,
+            apos,
+            RngRange(&game->rng, 0, 360),
+            1,
+            0.16
+        );
+
+        asteroids_to_spawn--;
+    }
+}
+
+static void ExplodePlayer(GameData *game, float delta_time) {
+    game->player_cooldown = 3.0f;
+    game->invicibility_time = 6.0f;
+    game->lives--;
+    game->player_velocity = (Vector2){0, 0};
+
+    //spawn particles in every direction, half of them super fast for looks
+    ParticleEmitter explosion = {
+        .position    = game->player_position,
+        .angle       = 180,
+        .spread      = 180,
+        .min_speed   = 1,
+        .max_speed   = 100,
+        .fast_chance = 0.5f,
+        .fast_speed  = 300,
+        .count       = 900
+    };
+
+    SpawnParticleBurst(game, &explosion, delta_time);
+
+    game->events |= GAME_EVENT_PLAYER_EXPLODED;
+}
+
+void GameStep(GameData *game, const Input *input, float delta_time) {
+    game->events = 0;
+    game->tick++;
+    game->delta_time = delta_time;
+    game->collision_stats = (CollisionStats){0};
+
+    //Spawn asteroids if none
+    if (game->asteroids.count == 0) {
+        SpawnAsteroidWave(game);
+    }
+
+    //Apply player input
+    if (game->player_cooldown == 0) {
+
+        if (input->rotate_right) {
+            game->player_rotation = UpdateRotation(game->player_rotation, 360, delta_time);
+        }
+
+        if (input->rotate_left) {
+            game->player_rotation = UpdateRotation(game->player_rotation, -360, delta_time);
+        }
+
+        if (input->fire) {
+
+            SpawnMissile(
+                game,
+                game->player_position,
+                game->player_rotation,
+                game->player_acceleration+500,
+                delta_time
+            );
+
+            game->events |= GAME_EVENT_MISSILE_FIRED;
+        }
+
+        if (input->thrust) {
+            game->player_acceleration = 1.0f;
+            game->thrusting = true;
+            game->thrust_time += 4;
+        }
+
+    }
+
+    if (!input->thrust||game->player_cooldown > 0) {
+        game->player_acceleration = 0.0f;
+        game->thrusting = false;
+        game->thrust_time = 0;
+    }
+
+    //Update Player
+
+    game->invicibility_time -= delta_time;
+    game->player_cooldown -= delta_time;
+
+    if (game->invicibility_time < 0.0f) {
+        game->invicibility_time = 0.0f;
+    }
+
+    if (game->player_cooldown < 0.0f) {
+        game->player_cooldown = 0.0f;
+    }
+
+    game->player_velocity = UpdateVelocity(
+        game->player_velocity,
+        game->player_acceleration,
+        game->player_rotation,
+        delta_time
+    );
+
+    game->player_position = UpdatePosition(
+        game->player_position,
+        game->player_velocity,
+        game->world_width,
+        game->world_height,
+        true
+    );
+
+    game->camera = CameraTarget(game, game->player_position);
+
+    PlaceShape(
+        game->shapes->ship[ShapeAngle(game->player_rotation)],
+        SHIP_GRAPHIC_LENGTH,
+        game->player_position,
+        game->ship_polygon
+    );
+
+    PROFILE_SCOPE(PROFILE_UPDATE_ASTEROIDS) {
+        UpdateAsteroids(game, delta_time);
+    }
+
+    PROFILE_SCOPE(PROFILE_UPDATE_PARTICLES) {
+        UpdateParticles(game, delta_time);
+    }
+
+    PROFILE_SCOPE(PROFILE_UPDATE_MISSILES) {
+        UpdateMissiles(game);
+    }
+
+    //Both collision checks look asteroids up in the grid built here
+    PROFILE_SCOPE(PROFILE_ASTEROID_GRID) {
+        BuildAsteroidGrid(game);
+    }
+
+    PROFILE_SCOPE(PROFILE_COLLISIONS) {
+        //Check player collision and kill player if hit asteroid
+        if (game->invicibility_time == 0.0f && game->player_cooldown == 0.0f) {
+
+            if (CheckPlayerCollision(game, delta_time)) {
+                ExplodePlayer(game, delta_time);
+            }
+        }
+
+        if (CheckMissileCollisions(game, delta_time)) {
+            game->events |= GAME_EVENT_ASTEROID_EXPLODED;
+        }
+    }
+
+    //Background, the frontend draws its stars drifting this way
+    game->background_rotation = UpdateRotation(game->background_rotation, 5.0f, delta_time);
+
+    //Thrust particles come out of the back of the ship
+    if (game->thrusting) {
+        ParticleEmitter exhaust = {
+            .position  = game->ship_polygon[2],
+            .angle     = game->player_rotation+180,
+            .spread    = 10,
+            .min_speed = game->player_acceleration+100.0f,
+            .max_speed = game->player_acceleration+100.0f+game->thrust_time,
+            .count     = 1
+        };
+
+        SpawnParticleBurst(game, &exhaust, delta_time);
+    }
+
+    PROFILE_SCOPE(PROFILE_SWEEP) {
+        SweepDeadEntities(game);
+
+        //sleeping asteroids drift out of their chunks, and new ones pile up at the end
+        if (game->tick%WORLD_FILE_TICKS == 0 || game->asteroids.count-game->asteroids_filed > WORLD_MAX_UNFILED) {
+            FileAsteroids(game);
+        }
+
+        FindActiveAsteroids(game);
+    }
+
+    PROFILE_GAUGE(PROFILE_PARTICLES, game->particles.count);
+    PROFILE_GAUGE(PROFILE_ASTEROIDS, game->asteroids.count);
+    PROFILE_GAUGE(PROFILE_MISSILES, game->missiles.count);
+}
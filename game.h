@@ -0,0 +1,424 @@
+#ifndef GAME_H
+#define GAME_H
+
+/*
+    Asteroids simulation. Everything in here runs without a window or an
+    audio device: the frontend turns key presses into an Input, calls
+    GameStep once per tick and reads GameData back for drawing and sound.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "vec2.h"
+#include "rng.h"
+#include "pool.h"
+#include "jobs.h"
+#include "grid.h"
+
+#define SHIP_GRAPHIC_LENGTH 5
+#define ASTEROID_GRAPHIC_LENGTH 9
+//Asteroids come in sizes 1, 3 and 5, larger is smaller on screen
+#define ASTEROID_MAX_SIZE 5
+
+typedef struct Input {
+    bool rotate_left;
+    bool rotate_right;
+    bool thrust;
+    //only true on the tick the fire key went down
+    bool fire;
+} Input;
+
+//Things that happened during the last GameStep, used by the frontend for sound
+typedef enum GameEvent {
+    GAME_EVENT_MISSILE_FIRED     = 1 << 0,
+    GAME_EVENT_ASTEROID_EXPLODED = 1 << 1,
+    GAME_EVENT_PLAYER_EXPLODED   = 1 << 2
+} GameEvent;
+
+//What is left of a destroyed asteroid, enough to spawn its debris and children
+typedef struct AsteroidDebris {
+    Vector2 position;
+    Vector2 velocity;
+    int size;
+} AsteroidDebris;
+
+//Reset every tick, shows how much work the bounding circles save
+typedef struct CollisionStats {
+    int candidates;
+    int bounding_rejects;
+    int exact_tests;
+} CollisionStats;
+
+/*
+    A burst of particles for SpawnParticleBurst. Speeds are accelerations
+    in the same units SpawnParticle takes.
+*/
+typedef struct ParticleEmitter {
+    Vector2 position;
+    //particles start anywhere in the box from position to position+area
+    Vector2 area;
+    //added to every particle, like SpawnParticle's initial_velocity
+    Vector2 velocity;
+    //degrees, particles head within spread either side of angle
+    float angle;
+    float spread;
+    //uniform between the two, except fast_chance (0 to 1) of them get fast_speed
+    float min_speed;
+    float max_speed;
+    float fast_chance;
+    float fast_speed;
+    int count;
+} ParticleEmitter;
+
+//Directions SpawnParticleBurst picks from, a power of two
+#define PARTICLE_DIRECTIONS 4096
+
+/*
+    How particles move. Integrated particles are stepped every tick like
+    everything else. Analytic ones only keep what they spawned with: they
+    only ever move in a straight line, so where one is now follows from its
+    age, and the tick it leaves the screen or dies of old age is rolled up
+    front. Nothing touches them again until their whole bucket has expired.
+*/
+typedef enum ParticleMode {
+    PARTICLES_INTEGRATED,
+    PARTICLES_ANALYTIC
+} ParticleMode;
+
+//Consecutive particle slots dropped together in analytic mode, a power of two
+#define PARTICLE_BUCKET_SIZE 4096
+
+//Rotations the shape tables hold, a power of two. Build with -DSHAPE_ANGLES=n to change it.
+#ifndef SHAPE_ANGLES
+#define SHAPE_ANGLES 1024
+#endif
+
+/*
+    The ship and asteroid graphics put through TransformPolygon at every
+    one of SHAPE_ANGLES rotations (and each asteroid size's scale) once, at
+    InitNewGame. Placing a shape is then a lookup and a translate, and
+    collision and drawing both use exactly the same points.
+*/
+typedef struct ShapeTables {
+    Vector2 ship[SHAPE_ANGLES][SHIP_GRAPHIC_LENGTH];
+    Vector2 asteroid[ASTEROID_MAX_SIZE+1][SHAPE_ANGLES][ASTEROID_GRAPHIC_LENGTH];
+} ShapeTables;
+
+//Larger than the biggest asteroid so a query only ever spans a few cells
+#define ASTEROID_GRID_CELL_SIZE 64
+
+/*
+    The world can be larger than the screen, see SetWorldSize. Asteroids
+    are kept sorted by the WORLD_CHUNK_SIZE square they are in, so each
+    chunk is one run of pool slots. Chunks overlapping the view, grown by
+    WORLD_ACTIVE_MARGIN, are active: moved every tick, checked for hits and
+    drawn. The ring of chunks around them moves every WORLD_NEAR_PERIOD
+    ticks and the rest every WORLD_FAR_PERIOD, each catching up on the
+    ticks it slept through in one go. Asteroids only collide with missiles
+    and the ship, both always in view, so nothing plays out differently
+    for an asteroid while it sleeps.
+
+    Asteroids are sorted again every WORLD_FILE_TICKS ticks, a sleeping one
+    can't get further than the margin from its chunk meanwhile. A world
+    that fits in one chunk is never reordered and plays exactly as the
+    screen sized game always did.
+*/
+#define WORLD_CHUNK_SIZE 1024
+#define WORLD_ACTIVE_MARGIN 256
+//Powers of two
+#define WORLD_NEAR_PERIOD 4
+#define WORLD_FAR_PERIOD 32
+#define WORLD_FILE_TICKS 16
+//Spawned asteroids wait at the end of the pool, always active, until they are filed
+#define WORLD_MAX_UNFILED 1024
+
+typedef struct GameData {
+    //Player data
+    Vector2 player_position;
+    Vector2 player_velocity;
+    float player_acceleration;
+    float player_rotation;
+    float player_rotational_velocity;
+    bool thrusting;
+    int thrust_time;
+    //Asteroid data
+    EntityPool asteroids;
+    float *asteroid_x;
+    float *asteroid_y;
+    float *asteroid_vx;
+    float *asteroid_vy;
+    float *asteroid_rotation;
+    float *asteroid_rotational_velocity;
+    int *asteroid_sizes;
+    //world space outline of each asteroid, shared by collision and rendering
+    Vector2 *asteroid_polygons;
+    //tick each asteroid has been moved up to, sleeping chunks fall behind
+    uint32_t *asteroid_tick;
+    //tick UpdateAsteroids last ran for, new asteroids start from it
+    uint32_t asteroids_moved;
+    //cell_start gives each chunk's run of slots, as of the last FileAsteroids
+    SpatialGrid asteroid_chunks;
+    //slots from here on were spawned since and are always active
+    int asteroids_filed;
+    //begin, end pairs of filed slots in active chunks, see ActiveRun
+    int *active_runs;
+    int active_run_count;
+    //the same for the chunks UpdateAsteroids moves this tick
+    int *moved_runs;
+    //room for every column of the pool while it is reordered
+    void *asteroid_scratch;
+    //only covers the active chunks, moved with them every tick
+    SpatialGrid asteroid_grid;
+    int *grid_candidates;
+    //asteroids hit this tick, broken up once every missile has been checked
+    AsteroidDebris *asteroid_hits;
+    //Particle data
+    EntityPool particles;
+    float *particle_x;
+    float *particle_y;
+    float *particle_vx;
+    float *particle_vy;
+    float *particle_time;
+    //INTEGRATE_* bits per slot, rewritten every tick by IntegrateParticles.
+    //A pool column only so it is committed and released with the rest.
+    unsigned char *particle_flags;
+    ParticleMode particle_mode;
+    //Analytic mode only: particle_x and particle_y hold the spawn position,
+    //alive from the tick after spawn_tick until death_tick (low 32 bits)
+    uint32_t *particle_spawn_tick;
+    uint32_t *particle_death_tick;
+    //latest death_tick written to each PARTICLE_BUCKET_SIZE run of slots
+    uint32_t *particle_bucket_death;
+    //fraction of each burst SpawnParticleBurst spawns, lowered by the frontend when frames run long
+    float particle_emission;
+    //unit vector UpdateVelocity would use for rotation i*360/PARTICLE_DIRECTIONS
+    Vector2 particle_directions[PARTICLE_DIRECTIONS];
+    //Missile data
+    EntityPool missiles;
+    Vector2 *missile_positions;
+    Vector2 *missile_velocities;
+    //Vector graphics, shared by collision and rendering
+    Vector2 ship_graphic[SHIP_GRAPHIC_LENGTH];
+    Vector2 asteroid_graphic[ASTEROID_GRAPHIC_LENGTH];
+    Vector2 ship_polygon[SHIP_GRAPHIC_LENGTH];
+    ShapeTables *shapes;
+    //bounding circle radii, asteroid_radius is indexed by size
+    float ship_radius;
+    float asteroid_radius[ASTEROID_MAX_SIZE+1];
+    CollisionStats collision_stats;
+    //GameData
+    int screen_height;
+    int screen_width;
+    //screen sized unless SetWorldSize made it bigger, everything wraps at its edges
+    int world_width;
+    int world_height;
+    //centre of the view in world coordinates, see CameraTarget
+    Vector2 camera;
+    int lives;
+    float invicibility_time;
+    float player_cooldown;
+    float background_rotation;
+    Vector2 background_speed;
+    unsigned int events;
+    unsigned long long tick;
+    //of the last GameStep, analytic particles age by it
+    float delta_time;
+    //gameplay randomness: asteroid spawns, splits and spins
+    Rng rng;
+    //particles only, so effects never change how a game plays out
+    Rng effects_rng;
+    //Set by the caller to spread updates over threads, NULL runs them all here
+    JobSystem *jobs;
+    //Kills counted by each update chunk before they are added to the pool
+    int *chunk_kills;
+}GameData;
+
+/*
+    Physics Functions
+*/
+
+Vector2 UpdatePosition(Vector2 pos, Vector2 velocity, int screen_width, int screen_height, bool wrap);
+Vector2 UpdateVelocity(Vector2 velocity, float acceleration, float rotation, float delta_time);
+float UpdateRotation(float current_rotation, float change_in_degrees, float delta_time);
+bool OffScreen(Vector2 v, int screen_width, int screen_height);
+void TransformPolygon(const Vector2 *points, int length, float rotation, Vector2 position, float scale, Vector2 *out);
+//Index of the shape table rotation nearest rotation degrees
+int ShapeAngle(float rotation);
+//Copies a shape table entry to out, moved to position
+void PlaceShape(const Vector2 *shape, int length, Vector2 position, Vector2 *out);
+
+/*
+    Game Functions
+*/
+
+//The max_ counts cap each pool, see EntityPool. Returns NULL if out of memory.
+GameData* InitNewGame(const int screen_height, const int screen_width, int max_asteroids, int max_particles, int max_missiles, unsigned int seed);
+void DeInitGame(GameData *game);
+//Makes the world width by height, with the ship in the middle. Call before anything is spawned.
+//Returns false if out of memory, the game can then only be freed.
+bool SetWorldSize(GameData *game, int width, int height);
+//Where the camera centres to follow focus, pulled in so the view stays inside the world
+Vector2 CameraTarget(const GameData *game, Vector2 focus);
+
+void SpawnMissile(GameData *game, Vector2 position, float rotation, float acceleration, float delta_time);
+void SpawnParticle(GameData *game, Vector2 position, Vector2 initial_velocity, float rotation, float acceleration, float delta_time);
+//Reserves room for the whole burst once and writes it straight into the particle columns
+void SpawnParticleBurst(GameData *game, const ParticleEmitter *emitter, float delta_time);
+//Refreshes asteroid_polygons for one asteroid
+void TransformAsteroid(GameData *game, int index);
+void SpawnAsteroid(GameData *game, int size, Vector2 position, float rotation, float acceleration, float delta_time);
+void DestroyAsteroid(GameData *game, int index, float delta_time);
+/*
+    Per tick updates. Each one is split into chunks of UPDATE_CHUNK_SIZE
+    entities run through game->jobs. Random numbers come from one stream per
+    chunk, so results do not depend on the thread count.
+*/
+//Only moves the chunks due this tick, see WORLD_CHUNK_SIZE
+void UpdateAsteroids(GameData *game, float delta_time);
+//Also kills particles that left the world or randomly expire with age,
+//analytic particles are only dropped a bucket at a time
+void UpdateParticles(GameData *game, float delta_time);
+//Also kills missiles that left the view
+void UpdateMissiles(GameData *game);
+/*
+    Switches particle_mode, carrying the live particles over. delta_time is
+    the tick length to age analytic particles by until the next GameStep.
+*/
+void SetParticleMode(GameData *game, ParticleMode mode, float delta_time);
+/*
+    Copies every field of src into dst except the memory dst owns (pools,
+    columns, grids, scratch) and its jobs, which stay dst's. The pools keep
+    dst's entities; CopyGameState and RestoreSnapshot fill them in after.
+*/
+void CopyGameFields(GameData *dst, const GameData *src);
+/*
+    Makes dst a copy of src for drawing: every field, and the live entities
+    of each pool starting from slot 0. dst comes from InitNewGame with the
+    same pool sizes and keeps its own memory and jobs. Per tick scratch
+    (the asteroid grid and particle buckets) is not copied. Returns false
+    if dst ran out of memory, any pool it could not fill is left empty.
+*/
+bool CopyGameState(GameData *dst, const GameData *src);
+//Removes everything killed this tick and trims the pools, called once at the end of GameStep
+void SweepDeadEntities(GameData *game);
+//All three pools added up, PoolGetMemory gives each on its own
+PoolMemory GameMemory(const GameData *game);
+//Sorts the asteroids into chunks, the pool must be swept
+void FileAsteroids(GameData *game);
+//Finds the active chunks around the camera for the next tick's collisions and drawing
+void FindActiveAsteroids(GameData *game);
+//Files the active asteroids in asteroid_grid, both checks below query it
+void BuildAsteroidGrid(GameData *game);
+bool CheckMissileCollisions(GameData *game, float delta_time);
+bool CheckPlayerCollision(GameData *game, float delta_time);
+
+//Age after which a particle has a small chance of dying every tick
+#define PARTICLE_OLD_AGE 3.0f
+
+#define UPDATE_CHUNK_SIZE 16384
+
+/*
+    The active asteroids lie in at most ActiveRunCount runs of slots, the
+    last one is everything spawned since they were filed. Walk them like
+    PoolSegment:
+
+        for (int r = 0; r < ActiveRunCount(game); r++) {
+            int start;
+            int length = ActiveRun(game, r, &start);
+            ...
+        }
+*/
+static inline int ActiveRunCount(const GameData *game) {
+    return game->active_run_count+1;
+}
+
+static inline int ActiveRun(const GameData *game, int run, int *start) {
+    if (run < game->active_run_count) {
+        *start = game->active_runs[run*2];
+        return game->active_runs[run*2+1]-*start;
+    }
+
+    *start = game->asteroids_filed;
+    return game->asteroids.count-game->asteroids_filed;
+}
+
+static inline int ActiveAsteroidCount(const GameData *game) {
+    int count = 0;
+
+    for (int r = 0; r < ActiveRunCount(game); r++) {
+        int start;
+        count += ActiveRun(game, r, &start);
+    }
+
+    return count;
+}
+
+//Top left corner of the view in world coordinates
+static inline Vector2 ViewOrigin(const GameData *game) {
+    return (Vector2){game->camera.x - game->screen_width*0.5f, game->camera.y - game->screen_height*0.5f};
+}
+
+//Whether a circle of radius around position is at least partly on screen
+static inline bool InView(const GameData *game, Vector2 position, float radius) {
+    Vector2 origin = ViewOrigin(game);
+
+    return position.x+radius >= origin.x && position.x-radius <= origin.x+game->screen_width
+        && position.y+radius >= origin.y && position.y-radius <= origin.y+game->screen_height;
+}
+
+//Ticks from one tick to another, correct across the 32 bit wrap
+static inline int TicksUntil(uint32_t from, uint32_t to) {
+    return (int)(int32_t)(to-from);
+}
+
+/*
+    Where particle slot is drawn alpha of the way from the previous tick to
+    this one, as start x, start y, then the end of its trail scaled by
+    trail. False for an analytic particle that expired but has not been
+    dropped yet.
+*/
+static inline bool ParticleSegment(const GameData *game, int slot, float alpha, float trail, float out[4]) {
+    float x = game->particle_x[slot];
+    float y = game->particle_y[slot];
+    float vx = game->particle_vx[slot];
+    float vy = game->particle_vy[slot];
+    float time;
+
+    if (game->particle_mode == PARTICLES_ANALYTIC) {
+        uint32_t now = (uint32_t)game->tick;
+
+        if (TicksUntil(now, game->particle_death_tick[slot]) <= 0) {
+            return false;
+        }
+
+        float age = (float)(now-game->particle_spawn_tick[slot]);
+        x += vx*age;
+        y += vy*age;
+        time = age*game->delta_time;
+    }
+
+    else {
+        time = game->particle_time[slot];
+    }
+
+    if (time > 0.9f) {
+        time = 0.9f;
+    }
+
+    //a step back along the velocity for the time since the last tick
+    x += vx*(alpha-1);
+    y += vy*(alpha-1);
+    //same trail as UpdatePosition with the velocity scaled by 8*(1-time)
+    trail *= 8*(1-time);
+
+    out[0] = x;
+    out[1] = y;
+    out[2] = x + vx*trail;
+    out[3] = y + vy*trail;
+    return true;
+}
+
+//Advances the simulation by one tick of delta_time seconds
+void GameStep(GameData *game, const Input *input, float delta_time);
+
+#endif
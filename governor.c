@@ -0,0 +1,82 @@
+#include <stdio.h>
+#include "governor.h"
+
+//Best first
+static const QualityLevel quality_levels[] = {
+    {"full",            1.0f,  1.0f,  2},
+    {"fewer particles", 0.5f,  1.0f,  2},
+    {"short trails",    0.5f,  0.5f,  1},
+    {"low",             0.25f, 0.25f, 1},
+    {"minimal",         0.1f,  0.25f, 0}
+};
+
+#define QUALITY_LEVEL_COUNT (int)(sizeof(quality_levels)/sizeof(quality_levels[0]))
+
+//Frames the average has to stay over target before stepping down
+#define GOVERNOR_DOWN_FRAMES 20
+//and under GOVERNOR_UP_FRACTION of it before stepping back up
+#define GOVERNOR_UP_FRAMES 300
+#define GOVERNOR_UP_FRACTION 0.7f
+
+void InitGovernor(Governor *governor, float target_ms) {
+    governor->target_ms    = target_ms;
+    governor->average_ms   = 0.0f;
+    governor->level        = 0;
+    governor->frames_over  = 0;
+    governor->frames_under = 0;
+    governor->held         = false;
+}
+
+static void SetLevel(Governor *governor, int level) {
+    printf(
+        "quality: %s -> %s (%.2f ms average, target %.2f ms)\n",
+        quality_levels[governor->level].name,
+        quality_levels[level].name,
+        governor->average_ms,
+        governor->target_ms
+    );
+
+    governor->level = level;
+    governor->frames_over = 0;
+    governor->frames_under = 0;
+}
+
+bool UpdateGovernor(Governor *governor, float frame_ms) {
+    if (governor->target_ms <= 0.0f || governor->held) {
+        return false;
+    }
+
+    //quick enough to catch a burst, smooth enough to ignore one slow frame
+    governor->average_ms += (frame_ms-governor->average_ms)*0.1f;
+
+    if (governor->average_ms > governor->target_ms) {
+        governor->frames_over++;
+        governor->frames_under = 0;
+    }
+
+    else if (governor->average_ms < governor->target_ms*GOVERNOR_UP_FRACTION) {
+        governor->frames_under++;
+        governor->frames_over = 0;
+    }
+
+    else {
+        governor->frames_over = 0;
+        governor->frames_under = 0;
+    }
+
+    if (governor->frames_over >= GOVERNOR_DOWN_FRAMES && governor->level < QUALITY_LEVEL_COUNT-1) {
+        SetLevel(governor, governor->level+1);
+        return true;
+    }
+
+    if (governor->frames_under >= GOVERNOR_UP_FRAMES && governor->level > 0) {
+        SetLevel(governor, governor->level-1);
+        return true;
+    }
+
+    return false;
+}
+
+const QualityLevel* GovernorQuality(const Governor *governor) {
+    return &quality_levels[governor->level];
+}
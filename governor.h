@@ -0,0 +1,43 @@
+#ifndef GOVERNOR_H
+#define GOVERNOR_H
+
+/*
+    Trades effects for frame time. Fed the time each frame took to build
+    (not counting the wait for vsync), it steps down through
+    quality_levels while the average stays over target_ms, and back up
+    once it has been comfortably under for a while. Stepping down reacts
+    in a fraction of a second, stepping up takes a few, so it doesn't
+    flip back and forth at the edge. Every change is printed.
+*/
+
+#include <stdbool.h>
+
+typedef struct QualityLevel {
+    const char *name;
+    //fraction of every particle burst that is spawned, see GameData
+    float particle_emission;
+    //trail length, 1 is the full trail
+    float particle_trail;
+    //background star layers drawn, nearest first
+    int star_layers;
+} QualityLevel;
+
+typedef struct Governor {
+    float target_ms;
+    //exponential average of the frame times fed in
+    float average_ms;
+    int level;
+    //frames in a row the average has been over target, or well under it
+    int frames_over;
+    int frames_under;
+    //held at the current level, e.g. while recording
+    bool held;
+} Governor;
+
+//target_ms of 0 or less keeps full quality
+void InitGovernor(Governor *governor, float target_ms);
+//Returns true if the level changed
+bool UpdateGovernor(Governor *governor, float frame_ms);
+const QualityLevel* GovernorQuality(const Governor *governor);
+
+#endif
@@ -0,0 +1,116 @@
+#include <stdlib.h>
+#include <math.h>
+#include "grid.h"
+
+bool GridInit(SpatialGrid *grid, float min_x, float min_y, float max_x, float max_y, float cell_size, int capacity) {
+    grid->origin_x    = min_x;
+    grid->origin_y    = min_y;
+    grid->cell_size   = cell_size;
+    grid->columns     = (int)ceilf((max_x-min_x)/cell_size);
+    grid->rows        = (int)ceilf((max_y-min_y)/cell_size);
+    grid->cell_start  = calloc(grid->columns*grid->rows+1, sizeof(int));
+    grid->entries     = malloc(sizeof(int)*capacity);
+    grid->entity_cell = malloc(sizeof(int)*capacity);
+    grid->capacity    = capacity;
+    grid->count       = 0;
+    return grid->cell_start != NULL && grid->entries != NULL && grid->entity_cell != NULL;
+}
+
+void GridFree(SpatialGrid *grid) {
+    free(grid->cell_start);
+    free(grid->entries);
+    free(grid->entity_cell);
+}
+
+static inline int Column(const SpatialGrid *grid, float x) {
+    int column = (int)floorf((x-grid->origin_x)/grid->cell_size);
+
+    if (column < 0) {
+        return 0;
+    }
+
+    if (column >= grid->columns) {
+        return grid->columns-1;
+    }
+
+    return column;
+}
+
+static inline int Row(const SpatialGrid *grid, float y) {
+    int row = (int)floorf((y-grid->origin_y)/grid->cell_size);
+
+    if (row < 0) {
+        return 0;
+    }
+
+    if (row >= grid->rows) {
+        return grid->rows-1;
+    }
+
+    return row;
+}
+
+void GridBuild(SpatialGrid *grid, const float *x, const float *y, int count) {
+    int run[2] = {0, count};
+    GridBuildRuns(grid, x, y, run, 1);
+}
+
+void GridBuildRuns(SpatialGrid *grid, const float *x, const float *y, const int *runs, int run_count) {
+    int cells = grid->columns*grid->rows;
+    int *start = grid->cell_start;
+    int count = 0;
+
+    for (int c = 0; c <= cells; c++) {
+        start[c] = 0;
+    }
+
+    //count entities per cell, shifted by one so the prefix sum gives starts
+    for (int r = 0; r < run_count; r++) {
+        for (int i = runs[r*2]; i < runs[r*2+1]; i++) {
+            int cell = Row(grid, y[i])*grid->columns + Column(grid, x[i]);
+            grid->entity_cell[i] = cell;
+            start[cell+1]++;
+        }
+
+        count += runs[r*2+1]-runs[r*2];
+    }
+
+    for (int c = 0; c < cells; c++) {
+        start[c+1] += start[c];
+    }
+
+    //scatter in index order, start[c] walks forward and ends at the next cell
+    for (int r = 0; r < run_count; r++) {
+        for (int i = runs[r*2]; i < runs[r*2+1]; i++) {
+            grid->entries[start[grid->entity_cell[i]]++] = i;
+        }
+    }
+
+    //undo the walk
+    for (int c = cells; c > 0; c--) {
+        start[c] = start[c-1];
+    }
+
+    start[0] = 0;
+    grid->count = count;
+}
+
+int GridQuery(const SpatialGrid *grid, float x, float y, float radius, int *out) {
+    int first_column = Column(grid, x-radius);
+    int last_column = Column(grid, x+radius);
+    int first_row = Row(grid, y-radius);
+    int last_row = Row(grid, y+radius);
+    int found = 0;
+
+    for (int row = first_row; row <= last_row; row++) {
+        for (int column = first_column; column <= last_column; column++) {
+            int cell = row*grid->columns + column;
+
+            for (int e = grid->cell_start[cell]; e < grid->cell_start[cell+1]; e++) {
+                out[found++] = grid->entries[e];
+            }
+        }
+    }
+
+    return found;
+}
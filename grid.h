@@ -0,0 +1,44 @@
+#ifndef GRID_H
+#define GRID_H
+
+/*
+    Uniform grid spatial hash, rebuilt from scratch every tick.
+
+    Each entity is filed under the cell holding its centre, so a query has
+    to grow its radius by the largest entity radius to find everything that
+    can touch it. Positions outside the grid are clamped to the edge cells.
+*/
+
+#include <stdbool.h>
+
+typedef struct SpatialGrid {
+    float origin_x;
+    float origin_y;
+    float cell_size;
+    int columns;
+    int rows;
+    //entries[cell_start[c] .. cell_start[c+1]) are the entities in cell c
+    int *cell_start;
+    int *entries;
+    int *entity_cell;
+    int capacity;
+    int count;
+} SpatialGrid;
+
+//Returns false if out of memory, GridFree still has to be called
+bool GridInit(SpatialGrid *grid, float min_x, float min_y, float max_x, float max_y, float cell_size, int capacity);
+void GridFree(SpatialGrid *grid);
+
+//Files entities 0..count-1 by position with a counting sort, O(count + cells)
+void GridBuild(SpatialGrid *grid, const float *x, const float *y, int count);
+//Same for the entities in run_count begin, end pairs of indices, in increasing order
+void GridBuildRuns(SpatialGrid *grid, const float *x, const float *y, const int *runs, int run_count);
+
+/*
+    Writes the index of every entity filed in a cell overlapping the square
+    around (x, y) into out, grouped by cell, and returns how many. out must
+    have room for grid->count entries.
+*/
+int GridQuery(const SpatialGrid *grid, float x, float y, float radius, int *out);
+
+#endif
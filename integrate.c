@@ -0,0 +1,179 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "integrate.h"
+
+#if !defined(INTEGRATE_SCALAR) && defined(__AVX2__)
+#include <immintrin.h>
+#define LANES 8
+typedef __m256 VFloat;
+#define VLoad(p)              _mm256_loadu_ps(p)
+#define VStore(p, v)          _mm256_storeu_ps(p, v)
+#define VSet(f)               _mm256_set1_ps(f)
+#define VAdd(a, b)            _mm256_add_ps(a, b)
+#define VOr(a, b)             _mm256_or_ps(a, b)
+#define VLess(a, b)           _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define VGreater(a, b)        _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define VSelect(mask, a, b)   _mm256_blendv_ps(b, a, mask)
+#define VMoveMask(m)          _mm256_movemask_ps(m)
+#elif !defined(INTEGRATE_SCALAR) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define LANES 4
+typedef __m128 VFloat;
+#define VLoad(p)              _mm_loadu_ps(p)
+#define VStore(p, v)          _mm_storeu_ps(p, v)
+#define VSet(f)               _mm_set1_ps(f)
+#define VAdd(a, b)            _mm_add_ps(a, b)
+#define VOr(a, b)             _mm_or_ps(a, b)
+#define VLess(a, b)           _mm_cmplt_ps(a, b)
+#define VGreater(a, b)        _mm_cmpgt_ps(a, b)
+#define VSelect(mask, a, b)   _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b))
+#define VMoveMask(m)          _mm_movemask_ps(m)
+#else
+#define LANES 1
+#endif
+
+#if defined(__GNUC__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define ALWAYS_INLINE __forceinline
+#else
+#define ALWAYS_INLINE inline
+#endif
+
+/*
+    Scalar step, shared by the reference functions and the SIMD tails.
+    wrap and aged are compile time constants at every call site so each
+    variant is its own branch free loop.
+*/
+static ALWAYS_INLINE void StepScalar(float *x, float *y, const float *vx, const float *vy, float *time,
+                                     unsigned char *flags, int i, float delta_time, float old_age,
+                                     float width, float height, const bool wrap, const bool aged) {
+    float px = x[i]+vx[i];
+    float py = y[i]+vy[i];
+
+    if (wrap) {
+        if (px < -15) {
+            px += width+15;
+        }
+
+        if (py < -15) {
+            py = height+15;
+        }
+
+        if (px > width+15) {
+            px = -15;
+        }
+
+        if (py > height+15) {
+            py = -15;
+        }
+    }
+
+    x[i] = px;
+    y[i] = py;
+
+    if (aged) {
+        float t = time[i]+delta_time;
+        time[i] = t;
+
+        unsigned char f = 0;
+
+        if (px < 0 || py < 0 || px > width || py > height) {
+            f |= INTEGRATE_OFFSCREEN;
+        }
+
+        if (t > old_age) {
+            f |= INTEGRATE_OLD;
+        }
+
+        flags[i] = f;
+    }
+}
+
+#if LANES > 1
+//Turns the low LANES bits of mask into one 0/1 byte per lane
+static inline uint64_t SpreadBits(unsigned int mask) {
+    uint64_t low = ((uint64_t)(mask & 0x7f)*0x0002040810204081ull) & 0x0101010101010101ull;
+    return low | ((uint64_t)((mask >> 7) & 1) << 56);
+}
+#endif
+
+static ALWAYS_INLINE void Integrate(float *x, float *y, const float *vx, const float *vy, float *time,
+                                    unsigned char *flags, int count, float delta_time, float old_age,
+                                    int screen_width, int screen_height, const bool wrap, const bool aged) {
+    float width = (float)screen_width;
+    float height = (float)screen_height;
+    int i = 0;
+
+#if LANES > 1
+    VFloat zero        = VSet(0.0f);
+    VFloat v_width     = VSet(width);
+    VFloat v_height    = VSet(height);
+    VFloat low_edge    = VSet(-15.0f);
+    VFloat wrap_x      = VSet(width+15);
+    VFloat wrap_y      = VSet(height+15);
+    VFloat v_dt        = VSet(delta_time);
+    VFloat v_old_age   = VSet(old_age);
+
+    for (; i+LANES <= count; i += LANES) {
+        VFloat px = VAdd(VLoad(x+i), VLoad(vx+i));
+        VFloat py = VAdd(VLoad(y+i), VLoad(vy+i));
+
+        if (wrap) {
+            //applied in the same order as UpdatePosition
+            px = VSelect(VLess(px, low_edge), VAdd(px, wrap_x), px);
+            py = VSelect(VLess(py, low_edge), wrap_y, py);
+            px = VSelect(VGreater(px, wrap_x), low_edge, px);
+            py = VSelect(VGreater(py, wrap_y), low_edge, py);
+        }
+
+        VStore(x+i, px);
+        VStore(y+i, py);
+
+        if (aged) {
+            VFloat t = VAdd(VLoad(time+i), v_dt);
+            VStore(time+i, t);
+
+            VFloat offscreen = VOr(
+                VOr(VLess(px, zero), VLess(py, zero)),
+                VOr(VGreater(px, v_width), VGreater(py, v_height))
+            );
+
+            uint64_t f = SpreadBits(VMoveMask(offscreen))*INTEGRATE_OFFSCREEN |
+                         SpreadBits(VMoveMask(VGreater(t, v_old_age)))*INTEGRATE_OLD;
+            memcpy(flags+i, &f, LANES);
+        }
+    }
+#endif
+
+    for (; i < count; i++) {
+        StepScalar(x, y, vx, vy, time, flags, i, delta_time, old_age, width, height, wrap, aged);
+    }
+}
+
+void IntegrateParticles(float *x, float *y, const float *vx, const float *vy, float *time,
+                        unsigned char *flags, int count, float delta_time, float old_age,
+                        int screen_width, int screen_height) {
+    Integrate(x, y, vx, vy, time, flags, count, delta_time, old_age, screen_width, screen_height, false, true);
+}
+
+void IntegrateWrapped(float *x, float *y, const float *vx, const float *vy, int count,
+                      int screen_width, int screen_height) {
+    Integrate(x, y, vx, vy, NULL, NULL, count, 0.0f, 0.0f, screen_width, screen_height, true, false);
+}
+
+void IntegrateParticlesScalar(float *x, float *y, const float *vx, const float *vy, float *time,
+                              unsigned char *flags, int count, float delta_time, float old_age,
+                              int screen_width, int screen_height) {
+    for (int i = 0; i < count; i++) {
+        StepScalar(x, y, vx, vy, time, flags, i, delta_time, old_age, screen_width, screen_height, false, true);
+    }
+}
+
+void IntegrateWrappedScalar(float *x, float *y, const float *vx, const float *vy, int count,
+                            int screen_width, int screen_height) {
+    for (int i = 0; i < count; i++) {
+        StepScalar(x, y, vx, vy, NULL, NULL, i, 0.0f, 0.0f, screen_width, screen_height, true, false);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef INTEGRATE_H
+#define INTEGRATE_H
+
+/*
+    Position integration over split x/y/vx/vy arrays. Each call advances
+    count entities by one tick with the same arithmetic as UpdatePosition.
+
+    Builds with AVX2 when the compiler targets it (-mavx2), otherwise SSE2
+    on x86-64, otherwise plain C. Define INTEGRATE_SCALAR to force the C
+    path.
+*/
+
+//Bits written to the flags array by IntegrateParticles
+#define INTEGRATE_OFFSCREEN 1
+#define INTEGRATE_OLD       2
+
+/*
+    No wrap. Also adds delta_time to time and writes one flags byte per
+    entity: INTEGRATE_OFFSCREEN if it left the screen (same test as
+    OffScreen) and INTEGRATE_OLD if its time is now past old_age.
+*/
+void IntegrateParticles(float *x, float *y, const float *vx, const float *vy, float *time,
+                        unsigned char *flags, int count, float delta_time, float old_age,
+                        int screen_width, int screen_height);
+
+//Wraps around the screen edges like UpdatePosition with wrap set
+void IntegrateWrapped(float *x, float *y, const float *vx, const float *vy, int count,
+                      int screen_width, int screen_height);
+
+//Plain C versions of the above, used for tails and as the reference
+void IntegrateParticlesScalar(float *x, float *y, const float *vx, const float *vy, float *time,
+                              unsigned char *flags, int count, float delta_time, float old_age,
+                              int screen_width, int screen_height);
+void IntegrateWrappedScalar(float *x, float *y, const float *vx, const float *vy, int count,
+                            int screen_width, int screen_height);
+
+#endif
@@ -0,0 +1,317 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "jobs.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+typedef struct Job {
+    JobFunc func;
+    void *data;
+    int begin;
+    int end;
+    int chunk;
+} Job;
+
+//Owner pops from the bottom, thieves take from the top
+typedef struct JobDeque {
+    pthread_mutex_t lock;
+    Job *jobs;
+    int top;
+    int bottom;
+    int capacity;
+} JobDeque;
+
+typedef struct Worker {
+    JobSystem *system;
+    int index;
+} Worker;
+
+struct JobSystem {
+    pthread_t *threads;
+    Worker *workers;
+    int worker_count;
+    //worker_count+1 deques, deque 0 belongs to the thread calling ParallelFor
+    JobDeque *deques;
+    int deque_count;
+    pthread_mutex_t wake_lock;
+    pthread_cond_t wake;
+    unsigned int generation;
+    bool quit;
+    atomic_int remaining;
+    //signalled when remaining reaches 0, ParallelFor sleeps on it
+    pthread_mutex_t done_lock;
+    pthread_cond_t done;
+};
+
+int ChunkCount(int count, int chunk_size) {
+    return (count+chunk_size-1)/chunk_size;
+}
+
+int DefaultWorkerCount(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int cores = (int)info.dwNumberOfProcessors;
+#else
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return cores > 1 ? cores-1 : 0;
+}
+
+/*
+    Deque
+*/
+
+//Returns false if the deque had to grow and couldn't
+static bool DequePush(JobDeque *deque, Job job) {
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom == deque->capacity) {
+        //only grows between batches, compact while we are at it
+        int length = deque->bottom-deque->top;
+
+        for (int i = 0; i < length; i++) {
+            deque->jobs[i] = deque->jobs[deque->top+i];
+        }
+
+        deque->top = 0;
+        deque->bottom = length;
+
+        if (deque->bottom == deque->capacity) {
+            int capacity = deque->capacity ? deque->capacity*2 : 64;
+            Job *grown = realloc(deque->jobs, sizeof(Job)*capacity);
+
+            if (grown == NULL) {
+                pthread_mutex_unlock(&deque->lock);
+                return false;
+            }
+
+            deque->jobs = grown;
+            deque->capacity = capacity;
+        }
+    }
+
+    deque->jobs[deque->bottom++] = job;
+    pthread_mutex_unlock(&deque->lock);
+    return true;
+}
+
+static bool DequePop(JobDeque *deque, Job *job) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom > deque->top) {
+        *job = deque->jobs[--deque->bottom];
+        found = true;
+    }
+
+    if (deque->bottom == deque->top) {
+        deque->top = 0;
+        deque->bottom = 0;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static bool DequeSteal(JobDeque *deque, Job *job) {
+    bool found = false;
+    pthread_mutex_lock(&deque->lock);
+
+    if (deque->bottom > deque->top) {
+        *job = deque->jobs[deque->top++];
+        found = true;
+    }
+
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+/*
+    Workers
+*/
+
+static void FinishJob(JobSystem *jobs) {
+    if (atomic_fetch_sub_explicit(&jobs->remaining, 1, memory_order_release) == 1) {
+        pthread_mutex_lock(&jobs->done_lock);
+        pthread_cond_broadcast(&jobs->done);
+        pthread_mutex_unlock(&jobs->done_lock);
+    }
+}
+
+//Runs jobs from our own deque, then from everyone else's, until none are left
+static void RunJobs(JobSystem *jobs, int self) {
+    Job job;
+
+    for (;;) {
+        bool found = DequePop(&jobs->deques[self], &job);
+
+        for (int i = 1; !found && i < jobs->deque_count; i++) {
+            found = DequeSteal(&jobs->deques[(self+i)%jobs->deque_count], &job);
+        }
+
+        if (!found) {
+            return;
+        }
+
+        job.func(job.data, job.begin, job.end, job.chunk);
+        FinishJob(jobs);
+    }
+}
+
+static void* WorkerMain(void *arg) {
+    Worker *worker = arg;
+    JobSystem *jobs = worker->system;
+    unsigned int seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&jobs->wake_lock);
+
+        while (jobs->generation == seen && !jobs->quit) {
+            pthread_cond_wait(&jobs->wake, &jobs->wake_lock);
+        }
+
+        seen = jobs->generation;
+        bool quit = jobs->quit;
+        pthread_mutex_unlock(&jobs->wake_lock);
+
+        if (quit) {
+            return NULL;
+        }
+
+        RunJobs(jobs, worker->index);
+    }
+}
+
+JobSystem* CreateJobSystem(int worker_count) {
+    JobSystem *jobs = calloc(1, sizeof(JobSystem));
+
+    if (jobs == NULL) {
+        return NULL;
+    }
+
+    jobs->worker_count = worker_count;
+    jobs->deque_count = worker_count+1;
+    jobs->deques = calloc(jobs->deque_count, sizeof(JobDeque));
+    jobs->threads = calloc(worker_count ? worker_count : 1, sizeof(pthread_t));
+    jobs->workers = calloc(worker_count ? worker_count : 1, sizeof(Worker));
+
+    if (jobs->deques == NULL || jobs->threads == NULL || jobs->workers == NULL) {
+        free(jobs->deques);
+        free(jobs->threads);
+        free(jobs->workers);
+        free(jobs);
+        return NULL;
+    }
+
+    atomic_init(&jobs->remaining, 0);
+    pthread_mutex_init(&jobs->wake_lock, NULL);
+    pthread_cond_init(&jobs->wake, NULL);
+    pthread_mutex_init(&jobs->done_lock, NULL);
+    pthread_cond_init(&jobs->done, NULL);
+
+    for (int i = 0; i < jobs->deque_count; i++) {
+        pthread_mutex_init(&jobs->deques[i].lock, NULL);
+    }
+
+    for (int i = 0; i < worker_count; i++) {
+        jobs->workers[i].system = jobs;
+        jobs->workers[i].index = i+1;
+
+        if (pthread_create(&jobs->threads[i], NULL, WorkerMain, &jobs->workers[i]) != 0) {
+            jobs->worker_count = i;
+            DestroyJobSystem(jobs);
+            return NULL;
+        }
+    }
+
+    return jobs;
+}
+
+void DestroyJobSystem(JobSystem *jobs) {
+    if (jobs == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&jobs->wake_lock);
+    jobs->quit = true;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->wake_lock);
+
+    for (int i = 0; i < jobs->worker_count; i++) {
+        pthread_join(jobs->threads[i], NULL);
+    }
+
+    for (int i = 0; i < jobs->deque_count; i++) {
+        pthread_mutex_destroy(&jobs->deques[i].lock);
+        free(jobs->deques[i].jobs);
+    }
+
+    pthread_mutex_destroy(&jobs->wake_lock);
+    pthread_cond_destroy(&jobs->wake);
+    pthread_mutex_destroy(&jobs->done_lock);
+    pthread_cond_destroy(&jobs->done);
+    free(jobs->deques);
+    free(jobs->threads);
+    free(jobs->workers);
+    free(jobs);
+}
+
+void ParallelFor(JobSystem *jobs, int count, int chunk_size, JobFunc func, void *data) {
+    int chunks = ChunkCount(count, chunk_size);
+
+    //nothing to share, run in order on this thread
+    if (jobs == NULL || jobs->worker_count == 0 || chunks <= 1) {
+        for (int c = 0; c < chunks; c++) {
+            int begin = c*chunk_size;
+            int end = begin+chunk_size < count ? begin+chunk_size : count;
+            func(data, begin, end, c);
+        }
+
+        return;
+    }
+
+    atomic_store_explicit(&jobs->remaining, chunks, memory_order_relaxed);
+
+    //give each deque a contiguous run of chunks so neighbours stay on one core,
+    //pushed back to front so owners pop them in order
+    for (int d = 0; d < jobs->deque_count; d++) {
+        int first = (int)((long long)chunks*d/jobs->deque_count);
+        int last = (int)((long long)chunks*(d+1)/jobs->deque_count);
+
+        for (int c = last-1; c >= first; c--) {
+            int begin = c*chunk_size;
+            int end = begin+chunk_size < count ? begin+chunk_size : count;
+
+            //out of memory for the deque, this thread does the chunk itself
+            if (!DequePush(&jobs->deques[d], (Job){func, data, begin, end, c})) {
+                func(data, begin, end, c);
+                atomic_fetch_sub_explicit(&jobs->remaining, 1, memory_order_relaxed);
+            }
+        }
+    }
+
+    pthread_mutex_lock(&jobs->wake_lock);
+    jobs->generation++;
+    pthread_cond_broadcast(&jobs->wake);
+    pthread_mutex_unlock(&jobs->wake_lock);
+
+    RunJobs(jobs, 0);
+
+    //sleep until the chunks still running on other threads are done,
+    //rather than spinning on a core the other job systems may want
+    pthread_mutex_lock(&jobs->done_lock);
+
+    while (atomic_load_explicit(&jobs->remaining, memory_order_acquire) > 0) {
+        pthread_cond_wait(&jobs->done, &jobs->done_lock);
+    }
+
+    pthread_mutex_unlock(&jobs->done_lock);
+}
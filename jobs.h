@@ -0,0 +1,35 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+/*
+    Small job system for splitting per-tick loops across cores.
+
+    ParallelFor cuts [0, count) into fixed size chunks and deals them out to
+    one deque per thread. Each thread works from the bottom of its own deque
+    and steals from the top of the others once it runs dry. The calling
+    thread takes part too, so a system with no workers just runs every chunk
+    in order on the caller.
+
+    Chunk boundaries depend only on count and chunk_size, never on the
+    number of threads, so anything keyed on the chunk index (random streams,
+    per-chunk results) comes out the same however the work was scheduled.
+*/
+
+//Processes [begin, end). chunk is begin/chunk_size.
+typedef void (*JobFunc)(void *data, int begin, int end, int chunk);
+
+typedef struct JobSystem JobSystem;
+
+//worker_count threads besides the caller. Returns NULL on failure.
+JobSystem* CreateJobSystem(int worker_count);
+void DestroyJobSystem(JobSystem *jobs);
+
+//One worker per core, leaving a core for the calling thread
+int DefaultWorkerCount(void);
+
+//Runs func over every chunk and returns once all are done. jobs may be NULL.
+void ParallelFor(JobSystem *jobs, int count, int chunk_size, JobFunc func, void *data);
+
+int ChunkCount(int count, int chunk_size);
+
+#endif
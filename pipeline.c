@@ -0,0 +1,110 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include "pipeline.h"
+
+struct Pipeline {
+    bool threaded;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;
+    //set by PipelineSubmit, cleared by the thread once the work is done
+    PipelineWork work;
+    void *data;
+    bool quit;
+};
+
+static void* PipelineThread(void *arg) {
+    Pipeline *pipeline = arg;
+
+    pthread_mutex_lock(&pipeline->lock);
+
+    while (true) {
+        while (pipeline->work == NULL && !pipeline->quit) {
+            pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+        }
+
+        if (pipeline->work == NULL) {
+            break;
+        }
+
+        PipelineWork work = pipeline->work;
+        void *data = pipeline->data;
+
+        pthread_mutex_unlock(&pipeline->lock);
+        work(data);
+        pthread_mutex_lock(&pipeline->lock);
+
+        pipeline->work = NULL;
+        pthread_cond_broadcast(&pipeline->changed);
+    }
+
+    pthread_mutex_unlock(&pipeline->lock);
+    return NULL;
+}
+
+Pipeline* CreatePipeline(bool threaded) {
+    Pipeline *pipeline = calloc(1, sizeof(Pipeline));
+
+    if (pipeline == NULL) {
+        return NULL;
+    }
+
+    pipeline->threaded = threaded;
+
+    if (threaded) {
+        pthread_mutex_init(&pipeline->lock, NULL);
+        pthread_cond_init(&pipeline->changed, NULL);
+
+        if (pthread_create(&pipeline->thread, NULL, PipelineThread, pipeline) != 0) {
+            //still works, just without the overlap
+            pthread_mutex_destroy(&pipeline->lock);
+            pthread_cond_destroy(&pipeline->changed);
+            pipeline->threaded = false;
+        }
+    }
+
+    return pipeline;
+}
+
+void DestroyPipeline(Pipeline *pipeline) {
+    if (pipeline->threaded) {
+        pthread_mutex_lock(&pipeline->lock);
+        pipeline->quit = true;
+        pthread_cond_broadcast(&pipeline->changed);
+        pthread_mutex_unlock(&pipeline->lock);
+
+        //the thread finishes any work still in flight first
+        pthread_join(pipeline->thread, NULL);
+        pthread_mutex_destroy(&pipeline->lock);
+        pthread_cond_destroy(&pipeline->changed);
+    }
+
+    free(pipeline);
+}
+
+void PipelineSubmit(Pipeline *pipeline, PipelineWork work, void *data) {
+    if (!pipeline->threaded) {
+        work(data);
+        return;
+    }
+
+    pthread_mutex_lock(&pipeline->lock);
+    pipeline->work = work;
+    pipeline->data = data;
+    pthread_cond_broadcast(&pipeline->changed);
+    pthread_mutex_unlock(&pipeline->lock);
+}
+
+void PipelineWait(Pipeline *pipeline) {
+    if (!pipeline->threaded) {
+        return;
+    }
+
+    pthread_mutex_lock(&pipeline->lock);
+
+    while (pipeline->work != NULL) {
+        pthread_cond_wait(&pipeline->changed, &pipeline->lock);
+    }
+
+    pthread_mutex_unlock(&pipeline->lock);
+}
@@ -0,0 +1,32 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/*
+    One background thread that runs a piece of work whenever it is handed
+    one. The frontend gives it the simulation ticks for the next frame and
+    draws the previous frame's snapshot meanwhile, so simulating and
+    drawing overlap instead of adding up.
+
+    Only one piece of work is ever in flight: PipelineSubmit must be
+    followed by PipelineWait before the next submit.
+*/
+
+#include <stdbool.h>
+
+typedef void (*PipelineWork)(void *data);
+
+typedef struct Pipeline Pipeline;
+
+/*
+    threaded false runs every submit straight away on the caller, for
+    comparison. Returns NULL if out of memory. If the thread can't be
+    started the pipeline runs unthreaded instead.
+*/
+Pipeline* CreatePipeline(bool threaded);
+void DestroyPipeline(Pipeline *pipeline);
+
+void PipelineSubmit(Pipeline *pipeline, PipelineWork work, void *data);
+//Returns once the last submitted work is done
+void PipelineWait(Pipeline *pipeline);
+
+#endif
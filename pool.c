@@ -0,0 +1,601 @@
+//for MAP_ANONYMOUS and madvise under -std=c11
+#define _DEFAULT_SOURCE
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+/*
+    Virtual Memory
+*/
+
+static size_t PageSize(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return (size_t)sysconf(_SC_PAGESIZE);
+#endif
+}
+
+static size_t RoundUp(size_t bytes, size_t page) {
+    return (bytes+page-1)/page*page;
+}
+
+//Address space only, nothing can be touched until committed
+static void* Reserve(size_t bytes) {
+#if defined(_WIN32)
+    return VirtualAlloc(NULL, bytes, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    void *address = mmap(NULL, bytes, PROT_NONE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    return address == MAP_FAILED ? NULL : address;
+#endif
+}
+
+static void Release(void *address, size_t bytes) {
+#if defined(_WIN32)
+    (void)bytes;
+    VirtualFree(address, 0, MEM_RELEASE);
+#else
+    munmap(address, bytes);
+#endif
+}
+
+//Commits every page [address, address+bytes) touches, zero filled the first time
+static bool Commit(char *address, size_t bytes) {
+    size_t page = PageSize();
+    uintptr_t start = (uintptr_t)address/page*page;
+    uintptr_t end = RoundUp((uintptr_t)address+bytes, page);
+
+#if defined(_WIN32)
+    return VirtualAlloc((void*)start, end-start, MEM_COMMIT, PAGE_READWRITE) != NULL;
+#else
+    return mprotect((void*)start, end-start, PROT_READ|PROT_WRITE) == 0;
+#endif
+}
+
+//Hands back the pages [address, address+bytes), both page aligned
+static void Decommit(char *address, size_t bytes) {
+#if defined(_WIN32)
+    VirtualFree(address, bytes, MEM_DECOMMIT);
+#else
+    madvise(address, bytes, MADV_DONTNEED);
+    mprotect(address, bytes, PROT_NONE);
+#endif
+}
+
+/*
+    Chunks
+*/
+
+//Reserved for capacity elements, at least a page
+static size_t ReservedBytes(const EntityPool *pool, int element_size) {
+    size_t bytes = RoundUp((size_t)element_size*pool->capacity, PageSize());
+    return bytes > 0 ? bytes : PageSize();
+}
+
+//The columns, then the dead marks as one more column of bytes
+static char* PoolArray(const EntityPool *pool, int array, int *element_size) {
+    if (array == pool->column_count) {
+        *element_size = 1;
+        return (char*)pool->dead;
+    }
+
+    *element_size = pool->column_sizes[array];
+    return pool->columns[array];
+}
+
+static int ChunkSlots(const EntityPool *pool, int chunk) {
+    int slots = pool->capacity - chunk*POOL_CHUNK_SLOTS;
+    return slots < POOL_CHUNK_SLOTS ? slots : POOL_CHUNK_SLOTS;
+}
+
+//Bytes of one array under chunk, the last chunk running to the end of the reservation
+static size_t ChunkBytes(const EntityPool *pool, int chunk, int element_size) {
+    size_t offset = (size_t)chunk*POOL_CHUNK_SLOTS*element_size;
+
+    if (chunk == pool->chunk_count-1) {
+        return ReservedBytes(pool, element_size)-offset;
+    }
+
+    return (size_t)POOL_CHUNK_SLOTS*element_size;
+}
+
+static bool CommitArray(const EntityPool *pool, char *array, int element_size, int chunk) {
+    return Commit(array + (size_t)chunk*POOL_CHUNK_SLOTS*element_size, ChunkBytes(pool, chunk, element_size));
+}
+
+static bool CommitChunk(EntityPool *pool, int chunk) {
+    for (int a = 0; a <= pool->column_count; a++) {
+        int size;
+        char *array = PoolArray(pool, a, &size);
+
+        if (!CommitArray(pool, array, size, chunk)) {
+            return false;
+        }
+    }
+
+    pool->chunk_committed[chunk] = 1;
+    pool->chunk_idle[chunk] = 0;
+    pool->committed_slots += ChunkSlots(pool, chunk);
+
+    if (pool->committed_slots > pool->peak_committed_slots) {
+        pool->peak_committed_slots = pool->committed_slots;
+    }
+
+    return true;
+}
+
+//Whether a committed chunk still has elements of array in the page at page_start
+static bool PageInUse(const EntityPool *pool, const char *array, int element_size, const char *page_start, size_t page) {
+    size_t chunk_bytes = (size_t)POOL_CHUNK_SLOTS*element_size;
+    size_t first = (size_t)(page_start-array)/chunk_bytes;
+    size_t last = (size_t)(page_start+page-1-array)/chunk_bytes;
+
+    if (last >= (size_t)pool->chunk_count) {
+        last = pool->chunk_count-1;
+    }
+
+    for (size_t chunk = first; chunk <= last; chunk++) {
+        if (pool->chunk_committed[chunk]) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*
+    Hands back every page of chunk no committed chunk shares. A page at
+    either end shared with a neighbour, when a chunk's bytes aren't a whole
+    number of pages, goes with whichever of the two is released last.
+*/
+static void DecommitChunk(EntityPool *pool, int chunk) {
+    size_t page = PageSize();
+    pool->chunk_committed[chunk] = 0;
+    pool->committed_slots -= ChunkSlots(pool, chunk);
+
+    for (int a = 0; a <= pool->column_count; a++) {
+        int size;
+        char *array = PoolArray(pool, a, &size);
+        size_t begin = (size_t)chunk*POOL_CHUNK_SLOTS*size;
+        //the reservation is page aligned, so offsets round like addresses
+        char *start = array + begin/page*page;
+        char *end = array + RoundUp(begin+ChunkBytes(pool, chunk, size), page);
+
+        if (PageInUse(pool, array, size, start, page)) {
+            start += page;
+        }
+
+        if (end > start && PageInUse(pool, array, size, end-page, page)) {
+            end -= page;
+        }
+
+        if (end > start) {
+            Decommit(start, end-start);
+        }
+    }
+}
+
+//Commits the chunks under count slots from first, wrapping to 0 at capacity
+static bool CommitSlots(EntityPool *pool, int first, int count) {
+    while (count > 0) {
+        int run = pool->capacity-first;
+
+        if (run > count) {
+            run = count;
+        }
+
+        for (int chunk = first/POOL_CHUNK_SLOTS; chunk <= (first+run-1)/POOL_CHUNK_SLOTS; chunk++) {
+            if (!pool->chunk_committed[chunk] && !CommitChunk(pool, chunk)) {
+                return false;
+            }
+        }
+
+        first = 0;
+        count -= run;
+    }
+
+    return true;
+}
+
+/*
+    Pool Functions
+*/
+
+bool PoolInit(EntityPool *pool, int capacity, PoolOverflow overflow) {
+    pool->column_count          = 0;
+    pool->dead_count            = 0;
+    pool->first_dead            = capacity;
+    pool->head                  = 0;
+    pool->count                 = 0;
+    pool->capacity              = capacity;
+    pool->overflow              = overflow;
+    pool->chunk_count           = (capacity+POOL_CHUNK_SLOTS-1)/POOL_CHUNK_SLOTS;
+    pool->committed_slots       = 0;
+    pool->peak_committed_slots  = 0;
+    pool->dead                  = Reserve(ReservedBytes(pool, 1));
+    pool->chunk_committed       = calloc(pool->chunk_count+1, 1);
+    pool->chunk_idle            = calloc(pool->chunk_count+1, 1);
+    pool->out_of_memory         = pool->dead == NULL || pool->chunk_committed == NULL || pool->chunk_idle == NULL;
+    return !pool->out_of_memory;
+}
+
+void PoolFree(EntityPool *pool) {
+    for (int i = 0; i < pool->column_count; i++) {
+        Release(pool->columns[i], ReservedBytes(pool, pool->column_sizes[i]));
+    }
+
+    if (pool->dead != NULL) {
+        Release(pool->dead, ReservedBytes(pool, 1));
+    }
+
+    free(pool->chunk_committed);
+    free(pool->chunk_idle);
+    pool->dead = NULL;
+    pool->chunk_committed = NULL;
+    pool->chunk_idle = NULL;
+    pool->column_count = 0;
+    pool->committed_slots = 0;
+    pool->head = 0;
+    pool->count = 0;
+}
+
+void* PoolAddColumn(EntityPool *pool, int element_size) {
+    char *column = Reserve(ReservedBytes(pool, element_size));
+
+    if (column == NULL) {
+        pool->out_of_memory = true;
+        return NULL;
+    }
+
+    int index = pool->column_count++;
+    pool->columns[index] = column;
+    pool->column_sizes[index] = element_size;
+
+    //chunks committed before this column was added
+    for (int chunk = 0; chunk < pool->chunk_count; chunk++) {
+        if (pool->chunk_committed[chunk] && !CommitArray(pool, column, element_size, chunk)) {
+            pool->out_of_memory = true;
+        }
+    }
+
+    return column;
+}
+
+//Moves slots [from, from+length) down to start at slot to, in every column
+static void MoveRange(EntityPool *pool, int to, int from, int length) {
+    for (int c = 0; c < pool->column_count; c++) {
+        char *column = pool->columns[c];
+        size_t size = pool->column_sizes[c];
+        memmove(column + to*size, column + from*size, length*size);
+    }
+}
+
+//Same as MoveRange but for ring positions, split where either side wraps
+static void MoveRingRange(EntityPool *pool, int to, int from, int length) {
+    while (length > 0) {
+        int src = PoolSlot(pool, from);
+        int dst = PoolSlot(pool, to);
+        int chunk = length;
+
+        if (src+chunk > pool->capacity) {
+            chunk = pool->capacity-src;
+        }
+
+        if (dst+chunk > pool->capacity) {
+            chunk = pool->capacity-dst;
+        }
+
+        MoveRange(pool, dst, src, chunk);
+        to += chunk;
+        from += chunk;
+        length -= chunk;
+    }
+}
+
+int PoolPush(EntityPool *pool) {
+
+    if (pool->count >= pool->capacity) {
+
+        if (pool->overflow == POOL_OVERWRITE_OLDEST) {
+            //the oldest entity's slot becomes the newest
+            int slot = pool->head;
+
+            if (pool->dead[slot]) {
+                pool->dead[slot] = 0;
+                pool->dead_count--;
+            }
+
+            pool->head = PoolSlot(pool, 1);
+            return slot;
+        }
+
+        //reuse a slot killed this tick rather than refusing the new entity,
+        //sweeping here would move entities callers may be iterating over
+        if (pool->dead_count > 0) {
+            int slot = pool->first_dead;
+
+            while (!pool->dead[slot]) {
+                slot++;
+            }
+
+            pool->dead[slot] = 0;
+            pool->dead_count--;
+            pool->first_dead = slot+1;
+            return slot;
+        }
+
+        return -1;
+    }
+
+    int slot = PoolSlot(pool, pool->count);
+    int chunk = slot/POOL_CHUNK_SLOTS;
+
+    if (!pool->chunk_committed[chunk] && !CommitChunk(pool, chunk)) {
+        return -1;
+    }
+
+    pool->count++;
+    pool->dead[slot] = 0;
+    return slot;
+}
+
+int PoolPushMany(EntityPool *pool, int count, int *first) {
+    int room = pool->capacity-pool->count;
+
+    //a full pool's slots are all committed already
+    if (!CommitSlots(pool, PoolSlot(pool, pool->count), count < room ? count : room)) {
+        return 0;
+    }
+
+    if (count > room) {
+
+        if (pool->overflow == POOL_OVERWRITE_OLDEST) {
+            //the oldest entities' slots become the newest
+            if (count > pool->capacity) {
+                count = pool->capacity;
+            }
+
+            int overwritten = count-room;
+
+            for (int position = 0; position < overwritten; position++) {
+                int slot = PoolSlot(pool, position);
+
+                if (pool->dead[slot]) {
+                    pool->dead[slot] = 0;
+                    pool->dead_count--;
+                }
+            }
+
+            pool->head = PoolSlot(pool, overwritten);
+            pool->count -= overwritten;
+        }
+
+        else {
+            count = room;
+        }
+    }
+
+    *first = PoolSlot(pool, pool->count);
+
+    //clear dead flags left in the free slots, in at most two runs
+    int run = pool->capacity-*first;
+
+    if (run > count) {
+        run = count;
+    }
+
+    memset(pool->dead+*first, 0, run);
+    memset(pool->dead, 0, count-run);
+
+    pool->count += count;
+    return count;
+}
+
+bool PoolCopy(EntityPool *dst, const EntityPool *src) {
+    dst->dead_count = 0;
+    dst->first_dead = dst->capacity;
+    dst->head = 0;
+    dst->count = 0;
+
+    if (!CommitSlots(dst, 0, src->count)) {
+        return false;
+    }
+
+    int first = src->capacity-src->head;
+
+    if (first > src->count) {
+        first = src->count;
+    }
+
+    for (int c = 0; c < src->column_count; c++) {
+        char *to = dst->columns[c];
+        const char *from = src->columns[c];
+        size_t size = src->column_sizes[c];
+
+        memcpy(to, from + src->head*size, first*size);
+        memcpy(to + first*size, from, (src->count-first)*size);
+    }
+
+    memset(dst->dead, 0, src->count);
+    dst->count = src->count;
+    return true;
+}
+
+void PoolReorder(EntityPool *pool, const int *order, void *scratch) {
+    for (int c = 0; c < pool->column_count; c++) {
+        char *column = pool->columns[c];
+        char *gathered = scratch;
+        size_t size = pool->column_sizes[c];
+
+        for (int p = 0; p < pool->count; p++) {
+            memcpy(gathered + p*size, column + PoolSlot(pool, order[p])*size, size);
+        }
+
+        //back in ring order, split where it wraps
+        int first = pool->capacity-pool->head;
+
+        if (first > pool->count) {
+            first = pool->count;
+        }
+
+        memcpy(column + pool->head*size, gathered, first*size);
+        memcpy(column, gathered + first*size, (pool->count-first)*size);
+    }
+}
+
+bool PoolSetLive(EntityPool *pool, int head, int count) {
+    pool->dead_count = 0;
+    pool->first_dead = pool->capacity;
+    pool->head = 0;
+    pool->count = 0;
+
+    if (!CommitSlots(pool, head, count)) {
+        return false;
+    }
+
+    pool->head = head;
+    pool->count = count;
+
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(pool, s, &start);
+        memset(pool->dead+start, 0, length);
+    }
+
+    return true;
+}
+
+int PoolWidestColumn(const EntityPool *pool) {
+    int widest = 0;
+
+    for (int c = 0; c < pool->column_count; c++) {
+        if (pool->column_sizes[c] > widest) {
+            widest = pool->column_sizes[c];
+        }
+    }
+
+    return widest;
+}
+
+void PoolDropOldest(EntityPool *pool, int count) {
+    if (count > pool->count) {
+        count = pool->count;
+    }
+
+    //only dead entities being dropped need their flags cleared
+    for (int position = 0; pool->dead_count > 0 && position < count; position++) {
+        int slot = PoolSlot(pool, position);
+
+        if (pool->dead[slot]) {
+            pool->dead[slot] = 0;
+            pool->dead_count--;
+        }
+    }
+
+    pool->head = PoolSlot(pool, count);
+    pool->count -= count;
+
+    if (pool->count == 0) {
+        pool->head = 0;
+    }
+}
+
+void PoolSweep(EntityPool *pool) {
+    if (pool->dead_count == 0) {
+        return;
+    }
+
+    int write = 0;
+    int position = 0;
+
+    //copy each run of live entities down over the gaps left by dead ones
+    while (position < pool->count) {
+
+        while (position < pool->count && pool->dead[PoolSlot(pool, position)]) {
+            pool->dead[PoolSlot(pool, position)] = 0;
+            position++;
+        }
+
+        int run_start = position;
+
+        while (position < pool->count && !pool->dead[PoolSlot(pool, position)]) {
+            position++;
+        }
+
+        int run_length = position-run_start;
+
+        if (run_length > 0 && write != run_start) {
+            MoveRingRange(pool, write, run_start, run_length);
+        }
+
+        write += run_length;
+    }
+
+    pool->count = write;
+    pool->dead_count = 0;
+    pool->first_dead = pool->capacity;
+
+    if (pool->count == 0) {
+        pool->head = 0;
+    }
+}
+
+//Whether any live entity is in chunk
+static bool ChunkLive(const EntityPool *pool, int chunk) {
+    int begin = chunk*POOL_CHUNK_SLOTS;
+    int end = begin+ChunkSlots(pool, chunk);
+
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(pool, s, &start);
+
+        if (length > 0 && start < end && start+length > begin) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void PoolTrim(EntityPool *pool) {
+    for (int chunk = 0; chunk < pool->chunk_count; chunk++) {
+
+        if (!pool->chunk_committed[chunk]) {
+            continue;
+        }
+
+        if (ChunkLive(pool, chunk)) {
+            pool->chunk_idle[chunk] = 0;
+        }
+
+        else if (++pool->chunk_idle[chunk] >= POOL_IDLE_TRIMS) {
+            DecommitChunk(pool, chunk);
+        }
+    }
+}
+
+PoolMemory PoolGetMemory(const EntityPool *pool) {
+    size_t slot_bytes = 1;
+    PoolMemory memory = {0};
+
+    for (int c = 0; c < pool->column_count; c++) {
+        slot_bytes += pool->column_sizes[c];
+        memory.reserved += ReservedBytes(pool, pool->column_sizes[c]);
+    }
+
+    memory.reserved += ReservedBytes(pool, 1);
+    memory.committed = (size_t)pool->committed_slots*slot_bytes;
+    memory.peak_committed = (size_t)pool->peak_committed_slots*slot_bytes;
+    memory.live = (size_t)pool->count*slot_bytes;
+    return memory;
+}
@@ -0,0 +1,197 @@
+#ifndef POOL_H
+#define POOL_H
+
+/*
+    Entity pool shared by asteroids, particles and missiles.
+
+    Entities are stored as parallel arrays (columns), one per field. Killing
+    an entity only marks it dead; PoolSweep removes every dead entity in one
+    linear pass at the end of the tick, keeping the live ones in order.
+
+    The live entities form a ring starting at head, oldest first. Pools
+    created with POOL_OVERWRITE_OLDEST never refuse a push: once full, the
+    oldest entity's slot is reused and head moves up by one. Walk the live
+    entities with PoolSegment rather than indexing 0..count directly.
+
+    Capacity is a cap, not a cost. Each column reserves address space for
+    capacity entities, but memory is only committed POOL_CHUNK_SLOTS slots
+    at a time as pushes reach them, and PoolTrim hands back chunks that
+    have held no live entity for POOL_IDLE_TRIMS trims. A pool sized for a
+    million particles takes what its live ones need, and columns never move.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define POOL_MAX_COLUMNS 12
+//Slots committed or released together, a power of two
+#define POOL_CHUNK_SLOTS 16384
+//Trims a chunk has to sit empty before it is released, about a second of ticks
+#define POOL_IDLE_TRIMS 120
+
+typedef enum PoolOverflow {
+    POOL_REJECT_WHEN_FULL,
+    POOL_OVERWRITE_OLDEST
+} PoolOverflow;
+
+typedef struct EntityPool {
+    void *columns[POOL_MAX_COLUMNS];
+    int column_sizes[POOL_MAX_COLUMNS];
+    int column_count;
+    unsigned char *dead;
+    int dead_count;
+    //no slot below this is marked dead, where a full pool starts looking for one
+    int first_dead;
+    int head;
+    int count;
+    int capacity;
+    PoolOverflow overflow;
+    //per chunk: committed in every column, and trims since it last held a live entity
+    unsigned char *chunk_committed;
+    unsigned char *chunk_idle;
+    int chunk_count;
+    int committed_slots;
+    int peak_committed_slots;
+    //set when a reservation failed, the pool can't be used
+    bool out_of_memory;
+} EntityPool;
+
+//In bytes, every column and the dead marks together
+typedef struct PoolMemory {
+    //address space for capacity entities, free until committed
+    size_t reserved;
+    size_t committed;
+    size_t peak_committed;
+    //what the live entities need
+    size_t live;
+} PoolMemory;
+
+//Returns false if out of memory, PoolFree still has to be called
+bool PoolInit(EntityPool *pool, int capacity, PoolOverflow overflow);
+void PoolFree(EntityPool *pool);
+
+//Reserves a column of capacity elements of element_size bytes, or returns NULL
+//and sets out_of_memory. Add every column before the first push.
+void* PoolAddColumn(EntityPool *pool, int element_size);
+
+//Returns the slot of a new entity, or -1 if the pool is full and rejects or
+//the slot's chunk could not be committed
+int PoolPush(EntityPool *pool);
+
+/*
+    Pushes up to count entities in one go and returns how many it pushed.
+    They take consecutive ring slots from *first, wrapping to 0 at capacity.
+    A full POOL_OVERWRITE_OLDEST pool gives up its oldest entities, a
+    rejecting one only fills the free slots. Pushes nothing if the slots
+    could not be committed.
+*/
+int PoolPushMany(EntityPool *pool, int count, int *first);
+
+/*
+    Copies the live entities of src into dst, oldest first from slot 0.
+    dst needs the same columns as src and at least its capacity. Dead
+    marks are not copied, so sweep src first. Returns false, leaving dst
+    empty, if dst could not commit room for them.
+*/
+bool PoolCopy(EntityPool *dst, const EntityPool *src);
+
+/*
+    Rearranges the live entities so position p holds what was at position
+    order[p]. order is a permutation of 0..count-1 and scratch has room for
+    count elements of the widest column. Sweep first.
+*/
+void PoolReorder(EntityPool *pool, const int *order, void *scratch);
+
+//Bytes taken by one entity's widest column, for sizing PoolReorder's scratch
+int PoolWidestColumn(const EntityPool *pool);
+
+/*
+    Makes the live entities the count slots from head, committing them and
+    clearing their dead marks, for a caller about to fill every column in
+    itself (restoring a snapshot). Returns false, leaving the pool empty,
+    if the slots could not be committed.
+*/
+bool PoolSetLive(EntityPool *pool, int head, int count);
+
+//Removes the count oldest entities without moving anything
+void PoolDropOldest(EntityPool *pool, int count);
+
+void PoolSweep(EntityPool *pool);
+
+//Ages the chunks no live entity is in and releases those idle long enough.
+//Call once a tick, after the sweep.
+void PoolTrim(EntityPool *pool);
+
+PoolMemory PoolGetMemory(const EntityPool *pool);
+
+static inline void PoolKill(EntityPool *pool, int index) {
+    if (!pool->dead[index]) {
+        pool->dead[index] = 1;
+        pool->dead_count++;
+
+        if (index < pool->first_dead) {
+            pool->first_dead = index;
+        }
+    }
+}
+
+//For kills made on several threads at once: marks index without counting it,
+//the caller adds up its marks and calls PoolAddDead when they are all done
+static inline void PoolMarkDead(EntityPool *pool, int index) {
+    pool->dead[index] = 1;
+}
+
+static inline void PoolAddDead(EntityPool *pool, int marked) {
+    pool->dead_count += marked;
+
+    //the marks could be anywhere
+    if (marked > 0) {
+        pool->first_dead = 0;
+    }
+}
+
+static inline bool PoolIsDead(const EntityPool *pool, int index) {
+    return pool->dead[index] != 0;
+}
+
+//Slot of the entity at ring position (0 is the oldest)
+static inline int PoolSlot(const EntityPool *pool, int position) {
+    int slot = pool->head+position;
+
+    if (slot >= pool->capacity) {
+        slot -= pool->capacity;
+    }
+
+    return slot;
+}
+
+/*
+    The live entities occupy at most two contiguous runs of slots. Segment 0
+    holds the oldest entities. Returns the run length and sets *start.
+
+        for (int s = 0; s < 2; s++) {
+            int start;
+            int length = PoolSegment(pool, s, &start);
+
+            for (int i = start; i < start+length; i++) {
+                ...
+            }
+        }
+*/
+static inline int PoolSegment(const EntityPool *pool, int segment, int *start) {
+    int first = pool->capacity-pool->head;
+
+    if (first > pool->count) {
+        first = pool->count;
+    }
+
+    if (segment == 0) {
+        *start = pool->head;
+        return first;
+    }
+
+    *start = 0;
+    return pool->count-first;
+}
+
+#endif
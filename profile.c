@@ -0,0 +1,185 @@
+#ifdef PROFILE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "profile.h"
+
+static const char *phase_names[PROFILE_PHASE_COUNT] = {
+    "frame",
+    "input",
+    "game_step",
+    "update_asteroids",
+    "update_particles",
+    "update_missiles",
+    "asteroid_grid",
+    "collisions",
+    "sweep",
+    "sound",
+    "draw_world",
+    "draw_particles",
+    "present"
+};
+
+static const char *gauge_names[PROFILE_GAUGE_COUNT] = {
+    "particles",
+    "asteroids",
+    "missiles"
+};
+
+static struct {
+    double started[PROFILE_PHASE_COUNT];
+    //this frame so far
+    double total[PROFILE_PHASE_COUNT];
+    //milliseconds per finished frame, history_next is the oldest
+    float history[PROFILE_PHASE_COUNT][PROFILE_HISTORY];
+    int history_next;
+    int history_count;
+    int gauges[PROFILE_GAUGE_COUNT];
+    unsigned long long frame;
+    FILE *csv;
+} profile;
+
+static double Seconds(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+void ProfileBegin(ProfilePhase phase) {
+    profile.started[phase] = Seconds();
+}
+
+void ProfileEnd(ProfilePhase phase) {
+    profile.total[phase] += Seconds()-profile.started[phase];
+}
+
+void ProfileBeginFrame(void) {
+    memset(profile.total, 0, sizeof(profile.total));
+    ProfileBegin(PROFILE_FRAME);
+}
+
+static void WriteCsvRow(void) {
+    fprintf(profile.csv, "%llu", profile.frame);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        fprintf(profile.csv, ",%.4f", profile.total[p]*1000.0);
+    }
+
+    for (int g = 0; g < PROFILE_GAUGE_COUNT; g++) {
+        fprintf(profile.csv, ",%d", profile.gauges[g]);
+    }
+
+    fputc('\n', profile.csv);
+}
+
+void ProfileEndFrame(void) {
+    ProfileEnd(PROFILE_FRAME);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        profile.history[p][profile.history_next] = (float)(profile.total[p]*1000.0);
+    }
+
+    profile.history_next = (profile.history_next+1)%PROFILE_HISTORY;
+
+    if (profile.history_count < PROFILE_HISTORY) {
+        profile.history_count++;
+    }
+
+    if (profile.csv) {
+        WriteCsvRow();
+    }
+
+    profile.frame++;
+}
+
+void ProfileSetGauge(ProfileGauge gauge, int value) {
+    profile.gauges[gauge] = value;
+}
+
+void ProfileReset(void) {
+    profile.history_next = 0;
+    profile.history_count = 0;
+    memset(profile.gauges, 0, sizeof(profile.gauges));
+}
+
+int ProfileGetGauge(ProfileGauge gauge) {
+    return profile.gauges[gauge];
+}
+
+static int CompareFloat(const void *a, const void *b) {
+    float x = *(const float*)a;
+    float y = *(const float*)b;
+    return (x > y) - (x < y);
+}
+
+ProfileStats ProfileGetStats(ProfilePhase phase) {
+    ProfileStats stats = {0};
+    int count = profile.history_count;
+
+    if (count == 0) {
+        return stats;
+    }
+
+    //order of the history doesn't matter for any of these
+    float sorted[PROFILE_HISTORY];
+    memcpy(sorted, profile.history[phase], sizeof(float)*count);
+    qsort(sorted, count, sizeof(float), CompareFloat);
+
+    double sum = 0;
+
+    for (int i = 0; i < count; i++) {
+        sum += sorted[i];
+    }
+
+    stats.min_ms     = sorted[0];
+    stats.average_ms = (float)(sum/count);
+    stats.p99_ms     = sorted[(count*99)/100];
+
+    return stats;
+}
+
+const char* ProfilePhaseName(ProfilePhase phase) {
+    return phase_names[phase];
+}
+
+const char* ProfileGaugeName(ProfileGauge gauge) {
+    return gauge_names[gauge];
+}
+
+bool ProfileOpenCsv(const char *path) {
+    ProfileCloseCsv();
+    profile.csv = fopen(path, "w");
+
+    if (profile.csv == NULL) {
+        return false;
+    }
+
+    fputs("frame", profile.csv);
+
+    for (int p = 0; p < PROFILE_PHASE_COUNT; p++) {
+        fprintf(profile.csv, ",%s_ms", phase_names[p]);
+    }
+
+    for (int g = 0; g < PROFILE_GAUGE_COUNT; g++) {
+        fprintf(profile.csv, ",%s", gauge_names[g]);
+    }
+
+    fputc('\n', profile.csv);
+
+    return true;
+}
+
+void ProfileCloseCsv(void) {
+    if (profile.csv) {
+        fclose(profile.csv);
+        profile.csv = NULL;
+    }
+}
+
+bool ProfileCsvOpen(void) {
+    return profile.csv != NULL;
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/*
+    Frame profiler, only built with -DPROFILE. Without it every macro below
+    expands to nothing and profile.c is empty, so release builds pay nothing.
+
+    Wrap a phase in PROFILE_SCOPE(PROFILE_SOMETHING) { ... } and its time is
+    added to the current frame. Phases may nest and run more than once per
+    frame. The last PROFILE_HISTORY frames are kept for min/avg/p99, and
+    ProfileOpenCsv streams one row per frame for offline analysis.
+
+    Not thread safe. Each phase and gauge belongs to one thread at a time:
+    the one calling ProfileEndFrame, or one it hands a phase to and waits
+    for before ProfileEndFrame, as the frontend does with PROFILE_GAME_STEP,
+    its sub-phases and the gauges on the pipeline thread. No other thread
+    may read a gauge while it can be set, copy it out where it was set.
+*/
+
+#include <stdbool.h>
+
+typedef enum ProfilePhase {
+    //whole frame, timed by ProfileBeginFrame/ProfileEndFrame
+    PROFILE_FRAME,
+    PROFILE_INPUT,
+    PROFILE_GAME_STEP,
+    PROFILE_UPDATE_ASTEROIDS,
+    PROFILE_UPDATE_PARTICLES,
+    PROFILE_UPDATE_MISSILES,
+    PROFILE_ASTEROID_GRID,
+    PROFILE_COLLISIONS,
+    PROFILE_SWEEP,
+    PROFILE_SOUND,
+    PROFILE_DRAW_WORLD,
+    PROFILE_DRAW_PARTICLES,
+    //EndDrawing, includes waiting for vsync
+    PROFILE_PRESENT,
+    PROFILE_PHASE_COUNT
+} ProfilePhase;
+
+typedef enum ProfileGauge {
+    PROFILE_PARTICLES,
+    PROFILE_ASTEROIDS,
+    PROFILE_MISSILES,
+    PROFILE_GAUGE_COUNT
+} ProfileGauge;
+
+#define PROFILE_HISTORY 240
+
+typedef struct ProfileStats {
+    float min_ms;
+    float average_ms;
+    float p99_ms;
+} ProfileStats;
+
+#ifdef PROFILE
+
+void ProfileBeginFrame(void);
+void ProfileEndFrame(void);
+void ProfileBegin(ProfilePhase phase);
+void ProfileEnd(ProfilePhase phase);
+void ProfileSetGauge(ProfileGauge gauge, int value);
+//Forgets the history, e.g. between benchmark runs
+void ProfileReset(void);
+
+//Over the last PROFILE_HISTORY frames, zeros before the first frame ends
+ProfileStats ProfileGetStats(ProfilePhase phase);
+int ProfileGetGauge(ProfileGauge gauge);
+const char* ProfilePhaseName(ProfilePhase phase);
+const char* ProfileGaugeName(ProfileGauge gauge);
+
+//Starts writing a row per frame to path, returns false if it can't be opened
+bool ProfileOpenCsv(const char *path);
+void ProfileCloseCsv(void);
+bool ProfileCsvOpen(void);
+
+//Runs the block that follows between ProfileBegin and ProfileEnd, don't return out of it
+#define PROFILE_SCOPE(phase) \
+    for (int profile_once_ = (ProfileBegin(phase), 1); profile_once_; profile_once_ = (ProfileEnd(phase), 0))
+//For phases that don't fit a block, e.g. ones declaring variables used later
+#define PROFILE_BEGIN(phase) ProfileBegin(phase)
+#define PROFILE_END(phase) ProfileEnd(phase)
+#define PROFILE_BEGIN_FRAME() ProfileBeginFrame()
+#define PROFILE_END_FRAME() ProfileEndFrame()
+#define PROFILE_GAUGE(gauge, value) ProfileSetGauge(gauge, value)
+
+#else
+
+#define PROFILE_SCOPE(phase)
+#define PROFILE_BEGIN(phase) ((void)0)
+#define PROFILE_END(phase) ((void)0)
+#define PROFILE_BEGIN_FRAME() ((void)0)
+#define PROFILE_END_FRAME() ((void)0)
+#define PROFILE_GAUGE(gauge, value) ((void)0)
+
+#endif
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+/*
+    The draw calls the world is drawn with. One backend is linked in:
+    render_raylib.c draws them, render_null.c only records them into a
+    command buffer, so the drawing code can be timed and checked on a
+    machine with no display.
+
+    Every backend counts draws and vertices between RenderBeginFrame calls.
+*/
+
+#include <stdio.h>
+#include "vec2.h"
+
+//raylib.h defines the same type and sets RL_COLOR_TYPE, include it first
+#if !defined(RL_COLOR_TYPE)
+typedef struct Color {
+    unsigned char r;
+    unsigned char g;
+    unsigned char b;
+    unsigned char a;
+} Color;
+#define RL_COLOR_TYPE
+#endif
+
+//What a circle counts as, raylib draws one as a fan of 36 triangles
+#define RENDER_CIRCLE_VERTICES (36*3)
+
+typedef struct RenderStats {
+    int draws;
+    long long vertices;
+} RenderStats;
+
+//Starts a new frame's counts, and a new command buffer for the null backend
+void RenderBeginFrame(void);
+RenderStats RenderGetStats(void);
+//Writes out every command recorded this frame, the null backend is the only one that keeps them.
+//It also says how many draws it had to drop, out of memory.
+void RenderDump(FILE *file);
+
+void RenderLine(Vector2 start, Vector2 end, Color color);
+void RenderLineStrip(const Vector2 *points, int count, Color color);
+void RenderCircle(Vector2 center, float radius, Color color);
+
+#endif
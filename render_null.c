@@ -0,0 +1,155 @@
+#include <stdlib.h>
+#include "render.h"
+
+typedef enum RenderCommandType {
+    RENDER_LINE,
+    RENDER_LINE_STRIP,
+    RENDER_CIRCLE
+} RenderCommandType;
+
+//Points live in one shared array, first is the index of the command's first one
+typedef struct RenderCommand {
+    RenderCommandType type;
+    Color color;
+    int first;
+    int count;
+    float radius;
+} RenderCommand;
+
+static const char *command_names[] = {"line", "line_strip", "circle"};
+
+static struct {
+    RenderCommand *commands;
+    int command_count;
+    int command_capacity;
+    Vector2 *points;
+    int point_count;
+    int point_capacity;
+    RenderStats stats;
+    //commands left out this frame because a buffer couldn't grow
+    int dropped;
+} recording;
+
+void RenderBeginFrame(void) {
+    recording.command_count = 0;
+    recording.point_count = 0;
+    recording.stats = (RenderStats){0};
+    recording.dropped = 0;
+}
+
+RenderStats RenderGetStats(void) {
+    return recording.stats;
+}
+
+/*
+    Room for one more command with count points. Buffers only grow, so a
+    steady frame stops allocating. Returns NULL, keeping what is recorded
+    and counting the command as dropped, if a buffer can't grow.
+*/
+static RenderCommand* Record(RenderCommandType type, Color color, int count) {
+    if (recording.command_count == recording.command_capacity) {
+        int capacity = recording.command_capacity ? recording.command_capacity*2 : 1024;
+        RenderCommand *commands = realloc(recording.commands, sizeof(RenderCommand)*capacity);
+
+        if (commands == NULL) {
+            recording.dropped++;
+            return NULL;
+        }
+
+        recording.commands = commands;
+        recording.command_capacity = capacity;
+    }
+
+    if (recording.point_count+count > recording.point_capacity) {
+        int capacity = recording.point_capacity;
+
+        while (recording.point_count+count > capacity) {
+            capacity = capacity ? capacity*2 : 4096;
+        }
+
+        Vector2 *points = realloc(recording.points, sizeof(Vector2)*capacity);
+
+        if (points == NULL) {
+            recording.dropped++;
+            return NULL;
+        }
+
+        recording.points = points;
+        recording.point_capacity = capacity;
+    }
+
+    RenderCommand *command = &recording.commands[recording.command_count++];
+    command->type = type;
+    command->color = color;
+    command->first = recording.point_count;
+    command->count = count;
+    command->radius = 0.0f;
+
+    recording.point_count += count;
+    recording.stats.draws++;
+    recording.stats.vertices += count;
+
+    return command;
+}
+
+void RenderLine(Vector2 start, Vector2 end, Color color) {
+    RenderCommand *command = Record(RENDER_LINE, color, 2);
+
+    if (command == NULL) {
+        return;
+    }
+
+    recording.points[command->first] = start;
+    recording.points[command->first+1] = end;
+}
+
+void RenderLineStrip(const Vector2 *points, int count, Color color) {
+    RenderCommand *command = Record(RENDER_LINE_STRIP, color, count);
+
+    if (command == NULL) {
+        return;
+    }
+
+
+    for (int i = 0; i < count; i++) {
+        recording.points[command->first+i] = points[i];
+    }
+}
+
+void RenderCircle(Vector2 center, float radius, Color color) {
+    RenderCommand *command = Record(RENDER_CIRCLE, color, 1);
+
+    if (command == NULL) {
+        return;
+    }
+
+    recording.points[command->first] = center;
+    command->radius = radius;
+    recording.stats.vertices += RENDER_CIRCLE_VERTICES-1;
+}
+
+void RenderDump(FILE *file) {
+    fprintf(file, "%d draws, %lld vertices\n", recording.stats.draws, recording.stats.vertices);
+
+    if (recording.dropped > 0) {
+        fprintf(file, "%d draws dropped, out of memory\n", recording.dropped);
+    }
+
+    for (int c = 0; c < recording.command_count; c++) {
+        const RenderCommand *command = &recording.commands[c];
+        Color color = command->color;
+
+        fprintf(file, "%s #%02x%02x%02x%02x", command_names[command->type], color.r, color.g, color.b, color.a);
+
+        if (command->type == RENDER_CIRCLE) {
+            fprintf(file, " r %.2f", command->radius);
+        }
+
+        for (int p = 0; p < command->count; p++) {
+            Vector2 point = recording.points[command->first+p];
+            fprintf(file, " %.2f,%.2f", point.x, point.y);
+        }
+
+        fprintf(file, "\n");
+    }
+}
@@ -0,0 +1,35 @@
+#include "raylib.h"
+#include "render.h"
+
+static RenderStats stats;
+
+void RenderBeginFrame(void) {
+    stats = (RenderStats){0};
+}
+
+RenderStats RenderGetStats(void) {
+    return stats;
+}
+
+void RenderDump(FILE *file) {
+    fprintf(file, "%d draws, %lld vertices, commands are only kept by the null backend\n", stats.draws, stats.vertices);
+}
+
+void RenderLine(Vector2 start, Vector2 end, Color color) {
+    DrawLineV(start, end, color);
+    stats.draws++;
+    stats.vertices += 2;
+}
+
+void RenderLineStrip(const Vector2 *points, int count, Color color) {
+    //older raylib takes a non const pointer, it never writes through it
+    DrawLineStrip((Vector2*)points, count, color);
+    stats.draws++;
+    stats.vertices += count;
+}
+
+void RenderCircle(Vector2 center, float radius, Color color) {
+    DrawCircleV(center, radius, color);
+    stats.draws++;
+    stats.vertices += RENDER_CIRCLE_VERTICES;
+}
@@ -0,0 +1,533 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "replay.h"
+
+#define REPLAY_BLOCK_SIZE 4096
+#define REPLAY_TAG_DELTA_TIME 0x10
+#define REPLAY_TAG_CHECKSUM 0x80
+
+static const unsigned char magic[4] = {'A', 'S', 'T', 'R'};
+
+/*
+    Checksum
+*/
+
+static inline uint32_t HashWord(uint32_t hash, uint32_t word) {
+    return (hash ^ word) * 0x01000193u;
+}
+
+static uint32_t HashBytes(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    size_t i = 0;
+
+    for (; i+4 <= size; i += 4) {
+        uint32_t word;
+        memcpy(&word, bytes+i, 4);
+        hash = HashWord(hash, word);
+    }
+
+    for (; i < size; i++) {
+        hash = HashWord(hash, bytes[i]);
+    }
+
+    return hash;
+}
+
+//Hashes column[i] for every live slot of pool, in pool order
+static uint32_t HashColumn(uint32_t hash, const EntityPool *pool, const void *column, size_t size) {
+    for (int s = 0; s < 2; s++) {
+        int start;
+        int length = PoolSegment(pool, s, &start);
+        hash = HashBytes(hash, (const unsigned char*)column + start*size, length*size);
+    }
+
+    return hash;
+}
+
+uint32_t GameChecksum(const GameData *game) {
+    uint32_t hash = 0x811c9dc5u;
+
+    hash = HashBytes(hash, &game->player_position, sizeof(Vector2));
+    hash = HashBytes(hash, &game->player_velocity, sizeof(Vector2));
+    hash = HashBytes(hash, &game->player_rotation, sizeof(float));
+    hash = HashBytes(hash, &game->invicibility_time, sizeof(float));
+    hash = HashBytes(hash, &game->player_cooldown, sizeof(float));
+    hash = HashWord(hash, (uint32_t)game->lives);
+    hash = HashWord(hash, (uint32_t)game->tick);
+    hash = HashBytes(hash, &game->rng, sizeof(Rng));
+    hash = HashBytes(hash, &game->effects_rng, sizeof(Rng));
+
+    const EntityPool *asteroids = &game->asteroids;
+    hash = HashWord(hash, (uint32_t)asteroids->count);
+    hash = HashColumn(hash, asteroids, game->asteroid_x, sizeof(float));
+    hash = HashColumn(hash, asteroids, game->asteroid_y, sizeof(float));
+    hash = HashColumn(hash, asteroids, game->asteroid_rotation, sizeof(float));
+    hash = HashColumn(hash, asteroids, game->asteroid_sizes, sizeof(int));
+
+    const EntityPool *particles = &game->particles;
+    hash = HashWord(hash, (uint32_t)particles->count);
+    hash = HashColumn(hash, particles, game->particle_x, sizeof(float));
+    hash = HashColumn(hash, particles, game->particle_y, sizeof(float));
+    hash = HashWord(hash, (uint32_t)game->particle_mode);
+
+    if (game->particle_mode == PARTICLES_ANALYTIC) {
+        hash = HashColumn(hash, particles, game->particle_spawn_tick, sizeof(uint32_t));
+        hash = HashColumn(hash, particles, game->particle_death_tick, sizeof(uint32_t));
+    }
+
+    else {
+        hash = HashColumn(hash, particles, game->particle_time, sizeof(float));
+    }
+
+    const EntityPool *missiles = &game->missiles;
+    hash = HashWord(hash, (uint32_t)missiles->count);
+    hash = HashColumn(hash, missiles, game->missile_positions, sizeof(Vector2));
+
+    return hash;
+}
+
+static unsigned char PackInput(const Input *input) {
+    return (input->rotate_left  ? 1 : 0)
+         | (input->rotate_right ? 2 : 0)
+         | (input->thrust       ? 4 : 0)
+         | (input->fire         ? 8 : 0);
+}
+
+static Input UnpackInput(unsigned char bits) {
+    Input input = {
+        .rotate_left  = bits & 1,
+        .rotate_right = bits & 2,
+        .thrust       = bits & 4,
+        .fire         = bits & 8
+    };
+
+    return input;
+}
+
+/*
+    Recording
+*/
+
+typedef struct ReplayBlock {
+    struct ReplayBlock *next;
+    int length;
+    unsigned char data[REPLAY_BLOCK_SIZE];
+} ReplayBlock;
+
+struct Recorder {
+    FILE *file;
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    //full blocks waiting for the writer, oldest first
+    ReplayBlock *queue_head;
+    ReplayBlock *queue_tail;
+    bool done;
+    //only touched by the game thread
+    ReplayBlock *block;
+    unsigned char run_bits;
+    uint32_t run_delta_bits;
+    long long run_length;
+    uint32_t last_delta_bits;
+    bool have_delta;
+    long long ticks;
+    //a block couldn't be allocated, nothing more is recorded
+    bool failed;
+};
+
+static void* WriterMain(void *data) {
+    Recorder *recorder = data;
+
+    pthread_mutex_lock(&recorder->lock);
+
+    for (;;) {
+        while (recorder->queue_head == NULL && !recorder->done) {
+            pthread_cond_wait(&recorder->ready, &recorder->lock);
+        }
+
+        if (recorder->queue_head == NULL) {
+            break;
+        }
+
+        ReplayBlock *block = recorder->queue_head;
+        recorder->queue_head = block->next;
+
+        if (recorder->queue_head == NULL) {
+            recorder->queue_tail = NULL;
+        }
+
+        //write without holding the lock so the game thread never waits on disk
+        pthread_mutex_unlock(&recorder->lock);
+        fwrite(block->data, 1, block->length, recorder->file);
+        free(block);
+        pthread_mutex_lock(&recorder->lock);
+    }
+
+    pthread_mutex_unlock(&recorder->lock);
+
+    return NULL;
+}
+
+static ReplayBlock* NewBlock(void) {
+    ReplayBlock *block = malloc(sizeof(ReplayBlock));
+
+    if (block == NULL) {
+        return NULL;
+    }
+
+    block->next = NULL;
+    block->length = 0;
+    return block;
+}
+
+static void SubmitBlock(Recorder *recorder) {
+    ReplayBlock *block = recorder->block;
+
+    pthread_mutex_lock(&recorder->lock);
+
+    if (recorder->queue_tail) {
+        recorder->queue_tail->next = block;
+    }
+
+    else {
+        recorder->queue_head = block;
+    }
+
+    recorder->queue_tail = block;
+    pthread_cond_signal(&recorder->ready);
+    pthread_mutex_unlock(&recorder->lock);
+
+    recorder->block = NULL;
+}
+
+static void PutByte(Recorder *recorder, unsigned char byte) {
+    if (recorder->failed) {
+        return;
+    }
+
+    if (recorder->block->length == REPLAY_BLOCK_SIZE) {
+        SubmitBlock(recorder);
+        recorder->block = NewBlock();
+
+        if (recorder->block == NULL) {
+            recorder->failed = true;
+            return;
+        }
+    }
+
+    recorder->block->data[recorder->block->length++] = byte;
+}
+
+static void PutU32(Recorder *recorder, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        PutByte(recorder, (unsigned char)(value >> (i*8)));
+    }
+}
+
+static void PutVarint(Recorder *recorder, unsigned long long value) {
+    while (value >= 0x80) {
+        PutByte(recorder, (unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+
+    PutByte(recorder, (unsigned char)value);
+}
+
+static void FlushRun(Recorder *recorder) {
+    if (recorder->run_length == 0) {
+        return;
+    }
+
+    bool new_delta = !recorder->have_delta || recorder->run_delta_bits != recorder->last_delta_bits;
+
+    PutByte(recorder, recorder->run_bits | (new_delta ? REPLAY_TAG_DELTA_TIME : 0));
+
+    if (new_delta) {
+        PutU32(recorder, recorder->run_delta_bits);
+        recorder->last_delta_bits = recorder->run_delta_bits;
+        recorder->have_delta = true;
+    }
+
+    PutVarint(recorder, recorder->run_length);
+    recorder->run_length = 0;
+}
+
+static void PutChecksum(Recorder *recorder, const GameData *game) {
+    FlushRun(recorder);
+    PutByte(recorder, REPLAY_TAG_CHECKSUM);
+    PutU32(recorder, GameChecksum(game));
+}
+
+static void WriteU32(FILE *file, uint32_t value) {
+    unsigned char bytes[4];
+
+    for (int i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (i*8));
+    }
+
+    fwrite(bytes, 1, 4, file);
+}
+
+Recorder* StartRecording(const char *path, const ReplayHeader *header) {
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fwrite(magic, 1, 4, file);
+    WriteU32(file, REPLAY_VERSION);
+    WriteU32(file, header->seed);
+    WriteU32(file, (uint32_t)header->screen_width);
+    WriteU32(file, (uint32_t)header->screen_height);
+    WriteU32(file, (uint32_t)header->max_asteroids);
+    WriteU32(file, (uint32_t)header->max_particles);
+    WriteU32(file, (uint32_t)header->max_missiles);
+    WriteU32(file, (uint32_t)header->particle_mode);
+    WriteU32(file, (uint32_t)header->world_width);
+    WriteU32(file, (uint32_t)header->world_height);
+
+    Recorder *recorder = calloc(1, sizeof(Recorder));
+
+    if (recorder == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    recorder->file = file;
+    recorder->block = NewBlock();
+
+    if (recorder->block == NULL) {
+        free(recorder);
+        fclose(file);
+        return NULL;
+    }
+
+    pthread_mutex_init(&recorder->lock, NULL);
+    pthread_cond_init(&recorder->ready, NULL);
+
+    if (pthread_create(&recorder->writer, NULL, WriterMain, recorder) != 0) {
+        pthread_mutex_destroy(&recorder->lock);
+        pthread_cond_destroy(&recorder->ready);
+        free(recorder->block);
+        free(recorder);
+        fclose(file);
+        return NULL;
+    }
+
+    return recorder;
+}
+
+bool RecordTick(Recorder *recorder, const Input *input, float delta_time, const GameData *game) {
+    if (recorder->failed) {
+        return false;
+    }
+
+    unsigned char bits = PackInput(input);
+    uint32_t delta_bits;
+    memcpy(&delta_bits, &delta_time, 4);
+
+    if (recorder->run_length > 0 && (bits != recorder->run_bits || delta_bits != recorder->run_delta_bits)) {
+        FlushRun(recorder);
+    }
+
+    recorder->run_bits = bits;
+    recorder->run_delta_bits = delta_bits;
+    recorder->run_length++;
+    recorder->ticks++;
+
+    if (recorder->ticks%REPLAY_CHECK_INTERVAL == 0) {
+        PutChecksum(recorder, game);
+    }
+
+    return !recorder->failed;
+}
+
+bool StopRecording(Recorder *recorder, const GameData *game) {
+    //after a failure the file ends where recording stopped
+    if (!recorder->failed) {
+        PutChecksum(recorder, game);
+    }
+
+    bool recorded = !recorder->failed;
+
+    if (recorder->block) {
+        SubmitBlock(recorder);
+    }
+
+    pthread_mutex_lock(&recorder->lock);
+    recorder->done = true;
+    pthread_cond_signal(&recorder->ready);
+    pthread_mutex_unlock(&recorder->lock);
+
+    pthread_join(recorder->writer, NULL);
+    pthread_mutex_destroy(&recorder->lock);
+    pthread_cond_destroy(&recorder->ready);
+
+    fclose(recorder->file);
+    free(recorder);
+
+    return recorded;
+}
+
+/*
+    Playback
+*/
+
+struct Replay {
+    FILE *file;
+    Input input;
+    float delta_time;
+    long long run_left;
+    long long ticks;
+    long long diverged_at;
+};
+
+static bool ReadU32(FILE *file, uint32_t *value) {
+    unsigned char bytes[4];
+
+    if (fread(bytes, 1, 4, file) != 4) {
+        return false;
+    }
+
+    *value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+    return true;
+}
+
+static bool ReadVarint(FILE *file, long long *value) {
+    unsigned long long result = 0;
+
+    for (int shift = 0; shift < 64; shift += 7) {
+        int byte = fgetc(file);
+
+        if (byte == EOF) {
+            return false;
+        }
+
+        result |= (unsigned long long)(byte & 0x7f) << shift;
+
+        if (!(byte & 0x80)) {
+            *value = (long long)result;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//Whether a game can be made from header, a bad file could ask for anything
+static bool HeaderSane(const ReplayHeader *header) {
+    return header->screen_width > 0 && header->screen_width <= REPLAY_MAX_WORLD_SIZE
+        && header->screen_height > 0 && header->screen_height <= REPLAY_MAX_WORLD_SIZE
+        && header->world_width >= header->screen_width && header->world_width <= REPLAY_MAX_WORLD_SIZE
+        && header->world_height >= header->screen_height && header->world_height <= REPLAY_MAX_WORLD_SIZE
+        && header->max_asteroids >= 0 && header->max_asteroids <= REPLAY_MAX_ENTITIES
+        && header->max_particles >= 0 && header->max_particles <= REPLAY_MAX_ENTITIES
+        && header->max_missiles >= 0 && header->max_missiles <= REPLAY_MAX_ENTITIES;
+}
+
+Replay* OpenReplay(const char *path, ReplayHeader *header) {
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return NULL;
+    }
+
+    unsigned char file_magic[4];
+    uint32_t fields[10];
+    bool ok = fread(file_magic, 1, 4, file) == 4 && memcmp(file_magic, magic, 4) == 0;
+
+    for (int i = 0; ok && i < 10; i++) {
+        ok = ReadU32(file, &fields[i]);
+    }
+
+    if (!ok || fields[0] != REPLAY_VERSION) {
+        fclose(file);
+        return NULL;
+    }
+
+    header->seed          = fields[1];
+    header->screen_width  = (int)fields[2];
+    header->screen_height = (int)fields[3];
+    header->max_asteroids = (int)fields[4];
+    header->max_particles = (int)fields[5];
+    header->max_missiles  = (int)fields[6];
+    header->particle_mode = fields[7] == PARTICLES_ANALYTIC ? PARTICLES_ANALYTIC : PARTICLES_INTEGRATED;
+    header->world_width   = (int)fields[8];
+    header->world_height  = (int)fields[9];
+
+    if (!HeaderSane(header)) {
+        fclose(file);
+        return NULL;
+    }
+
+    Replay *replay = calloc(1, sizeof(Replay));
+
+    if (replay == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    replay->file = file;
+    replay->diverged_at = -1;
+
+    return replay;
+}
+
+bool ReplayTick(Replay *replay, const GameData *game, Input *input, float *delta_time) {
+    while (replay->run_left == 0) {
+        int tag = fgetc(replay->file);
+
+        if (tag == EOF) {
+            return false;
+        }
+
+        if (tag == REPLAY_TAG_CHECKSUM) {
+            uint32_t checksum;
+
+            if (!ReadU32(replay->file, &checksum)) {
+                return false;
+            }
+
+            if (replay->diverged_at < 0 && checksum != GameChecksum(game)) {
+                replay->diverged_at = replay->ticks;
+            }
+
+            continue;
+        }
+
+        replay->input = UnpackInput((unsigned char)tag);
+
+        if (tag & REPLAY_TAG_DELTA_TIME) {
+            uint32_t delta_bits;
+
+            if (!ReadU32(replay->file, &delta_bits)) {
+                return false;
+            }
+
+            memcpy(&replay->delta_time, &delta_bits, 4);
+        }
+
+        if (!ReadVarint(replay->file, &replay->run_left)) {
+            return false;
+        }
+    }
+
+    replay->run_left--;
+    replay->ticks++;
+    *input = replay->input;
+    *delta_time = replay->delta_time;
+
+    return true;
+}
+
+long long ReplayDivergedAt(const Replay *replay) {
+    return replay->diverged_at;
+}
+
+void CloseReplay(Replay *replay) {
+    fclose(replay->file);
+    free(replay);
+}
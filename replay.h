@@ -0,0 +1,89 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+/*
+    Input recording and playback. A game is fully determined by the
+    arguments to InitNewGame and SetWorldSize plus the Input and
+    delta_time of every tick, so that is all a recording holds.
+
+    File layout, all integers little endian:
+
+        header      "ASTR", version, then the ReplayHeader fields as u32
+        records     one tag byte each, then its payload
+
+    A tick record's tag holds the four Input bits in bits 0-3. Bit 4 says a
+    new delta_time follows as raw float bits, otherwise the previous one is
+    reused. A varint run length follows: that many identical ticks in a row.
+    Tag REPLAY_TAG_CHECKSUM is followed by a u32 GameChecksum of the state
+    after every tick so far. One is written every REPLAY_CHECK_INTERVAL
+    ticks and one at the end, so playback can say where it diverged.
+
+    The recorder fills blocks on the game thread and a background thread
+    writes them out, so recording never waits on the disk.
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "game.h"
+
+//Bump whenever GameStep plays out differently, old recordings won't match
+#define REPLAY_VERSION 7
+#define REPLAY_CHECK_INTERVAL 120
+//Largest screen or world side and pool capacity a recording may ask for
+#define REPLAY_MAX_WORLD_SIZE (1 << 20)
+#define REPLAY_MAX_ENTITIES (1 << 24)
+
+typedef struct ReplayHeader {
+    uint32_t seed;
+    int screen_width;
+    int screen_height;
+    int max_asteroids;
+    int max_particles;
+    int max_missiles;
+    ParticleMode particle_mode;
+    //passed to SetWorldSize
+    int world_width;
+    int world_height;
+} ReplayHeader;
+
+typedef struct Recorder Recorder;
+typedef struct Replay Replay;
+
+/*
+    Hash of everything that moves, equal states give equal checksums.
+    Analytic particles are hashed by what they spawned with.
+*/
+uint32_t GameChecksum(const GameData *game);
+
+//Returns NULL if path can't be opened for writing or out of memory
+Recorder* StartRecording(const char *path, const ReplayHeader *header);
+/*
+    Call after each GameStep with the input and delta_time it was given.
+    Returns false once a block couldn't be allocated: recording has stopped
+    and later ticks are ignored, StopRecording still has to be called.
+*/
+bool RecordTick(Recorder *recorder, const Input *input, float delta_time, const GameData *game);
+/*
+    Writes the final checksum, waits for the writer thread and closes the
+    file. Returns false if recording stopped early, the file then ends
+    without its final checksum.
+*/
+bool StopRecording(Recorder *recorder, const GameData *game);
+
+/*
+    Returns NULL if path is missing, not a recording, asks for a game that
+    can't be made (sizes not positive, a world smaller than the screen, or
+    past the REPLAY_MAX_ limits) or out of memory. Fills header otherwise.
+*/
+Replay* OpenReplay(const char *path, ReplayHeader *header);
+/*
+    Gives the input and delta_time for the next tick, checking any checksum
+    recorded for the ticks game has run so far. Returns false once the
+    recording runs out.
+*/
+bool ReplayTick(Replay *replay, const GameData *game, Input *input, float *delta_time);
+//Tick whose checksum first failed, -1 if none has
+long long ReplayDivergedAt(const Replay *replay);
+void CloseReplay(Replay *replay);
+
+#endif
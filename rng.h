@@ -0,0 +1,121 @@
+#ifndef RNG_H
+#define RNG_H
+
+/*
+    Seedable random numbers for the simulation. Replaces raylib's
+    GetRandomValue so a game can be seeded and stepped without a window.
+
+    xoshiro128** with an explicit state, so every user owns its stream and
+    nothing is shared between threads. Streams are seeded from (seed,
+    stream) through splitmix64, which gives unrelated starting states even
+    for neighbouring stream numbers. The same seed and stream always give
+    the same numbers on every platform.
+*/
+
+#include <stdint.h>
+
+typedef struct Rng {
+    uint32_t state[4];
+} Rng;
+
+//Streams for the generators GameData owns, worker chunks derive their own
+enum {
+    RNG_STREAM_GAME,
+    RNG_STREAM_EFFECTS,
+    //anything the frontend adds on its own, e.g. stress test particles
+    RNG_STREAM_FRONTEND,
+    RNG_STREAM_STARFIELD
+};
+
+static inline uint64_t RngSplitMix(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+//Independent stream number stream of seed, e.g. one per job chunk
+static inline void RngSeedStream(Rng *rng, uint32_t seed, uint32_t stream) {
+    uint64_t x = (uint64_t)seed << 32 | stream;
+    uint64_t a = RngSplitMix(&x);
+    uint64_t b = RngSplitMix(&x);
+
+    rng->state[0] = (uint32_t)a;
+    rng->state[1] = (uint32_t)(a >> 32);
+    rng->state[2] = (uint32_t)b;
+    rng->state[3] = (uint32_t)(b >> 32);
+
+    //xoshiro can never leave the all zero state
+    if ((rng->state[0] | rng->state[1] | rng->state[2] | rng->state[3]) == 0) {
+        rng->state[0] = 0x9e3779b9u;
+    }
+}
+
+static inline void RngSeed(Rng *rng, uint32_t seed) {
+    RngSeedStream(rng, seed, 0);
+}
+
+static inline uint32_t RngRotate(uint32_t x, int k) {
+    return (x << k) | (x >> (32-k));
+}
+
+static inline uint32_t RngNext(Rng *rng) {
+    uint32_t *s = rng->state;
+    uint32_t result = RngRotate(s[1]*5, 7)*9;
+    uint32_t t = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = RngRotate(s[3], 11);
+
+    return result;
+}
+
+//Same contract as GetRandomValue: inclusive on both ends
+static inline int RngRange(Rng *rng, int min, int max) {
+    if (min > max) {
+        int tmp = max;
+        max = min;
+        min = tmp;
+    }
+
+    //multiply and keep the top half rather than a modulo
+    uint32_t range = (uint32_t)(max-min)+1;
+    return min + (int)(((uint64_t)RngNext(rng)*range) >> 32);
+}
+
+//Uniform in [min, max)
+static inline float RngFloat(Rng *rng, float min, float max) {
+    //top 24 bits, exactly representable as a float
+    return min + (max-min)*((RngNext(rng) >> 8)*(1.0f/16777216.0f));
+}
+
+/*
+    Batch versions for filling a buffer ahead of the loop that uses it. The
+    state stays in registers for the whole fill, and the results are the
+    same as calling the single versions count times.
+*/
+static inline void RngFillFloat(Rng *rng, float *out, int count, float min, float max) {
+    Rng local = *rng;
+
+    for (int i = 0; i < count; i++) {
+        out[i] = RngFloat(&local, min, max);
+    }
+
+    *rng = local;
+}
+
+static inline void RngFillRange(Rng *rng, int *out, int count, int min, int max) {
+    Rng local = *rng;
+
+    for (int i = 0; i < count; i++) {
+        out[i] = RngRange(&local, min, max);
+    }
+
+    *rng = local;
+}
+
+#endif
@@ -0,0 +1,539 @@
+//for mmap under -std=c11
+#define _DEFAULT_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define SNAPSHOT_ALIGN 64
+//Bytes per copy job, big enough that handing one out costs nothing next to it
+#define SNAPSHOT_COPY_BLOCK (256*1024)
+//Every column of every pool in two segments, then the three sections after them
+#define SNAPSHOT_MAX_COPIES (3*POOL_MAX_COLUMNS*2 + 3)
+
+static const char magic[4] = {'A', 'S', 'N', 'P'};
+
+typedef struct SnapshotCopy {
+    unsigned char *to;
+    const unsigned char *from;
+    size_t bytes;
+} SnapshotCopy;
+
+typedef struct CopyList {
+    SnapshotCopy copies[SNAPSHOT_MAX_COPIES];
+    //first SNAPSHOT_COPY_BLOCK of each copy, the entry after the last is the total
+    int first_block[SNAPSHOT_MAX_COPIES+1];
+    int count;
+} CopyList;
+
+//Where the sections SnapshotFits looks inside start in the block
+typedef struct SnapshotSections {
+    size_t asteroid_sizes;
+    size_t cell_start;
+    size_t active_runs;
+} SnapshotSections;
+
+static size_t Align(size_t offset) {
+    return (offset+SNAPSHOT_ALIGN-1)/SNAPSHOT_ALIGN*SNAPSHOT_ALIGN;
+}
+
+static const size_t header_bytes = (sizeof(SnapshotHeader)+SNAPSHOT_ALIGN-1)/SNAPSHOT_ALIGN*SNAPSHOT_ALIGN;
+
+/*
+    Layout
+*/
+
+//Whether a column of pool goes into a snapshot taken in mode, see snapshot.h
+static bool ColumnSaved(const GameData *game, ParticleMode mode, const EntityPool *pool, const void *column) {
+    if (pool != &game->particles) {
+        return true;
+    }
+
+    if (column == game->particle_flags) {
+        return false;
+    }
+
+    if (mode == PARTICLES_ANALYTIC) {
+        return column != game->particle_time;
+    }
+
+    return column != game->particle_spawn_tick && column != game->particle_death_tick;
+}
+
+//Adds a copy of bytes between game memory and the block at offset, into the block if to_block
+static void AddCopy(CopyList *list, void *memory, unsigned char *block, size_t offset, size_t bytes, bool to_block) {
+    if (list == NULL || bytes == 0) {
+        return;
+    }
+
+    SnapshotCopy *copy = &list->copies[list->count++];
+    copy->to = to_block ? block+offset : memory;
+    copy->from = to_block ? memory : block+offset;
+    copy->bytes = bytes;
+}
+
+//Where the section after one ending at end starts, zeroing the gap when writing block
+static size_t NextSection(unsigned char *block, size_t end, bool to_block) {
+    size_t next = Align(end);
+
+    //a reused block would otherwise keep whatever an earlier snapshot left there
+    if (block != NULL && to_block) {
+        memset(block+end, 0, next-end);
+    }
+
+    return next;
+}
+
+/*
+    Walks the sections after the GameData one, adding a copy between game's
+    memory and block for each to list unless it is NULL. The counts, ring
+    heads and particle mode come from header, the columns from game. Fills
+    in sections unless it is NULL. Returns the size of the whole block.
+*/
+static size_t SnapshotLayout(const GameData *game, const SnapshotHeader *header, unsigned char *block, bool to_block, CopyList *list, SnapshotSections *sections) {
+    SnapshotSections ignored;
+    sections = sections ? sections : &ignored;
+
+    size_t offset = header_bytes + Align(sizeof(GameData));
+    const EntityPool *pools[] = {&game->asteroids, &game->particles, &game->missiles};
+
+    for (int p = 0; p < 3; p++) {
+        //the pool as it was saved, only its ring is used
+        EntityPool ring = *pools[p];
+        ring.head = header->head[p];
+        ring.count = header->count[p];
+
+        for (int c = 0; c < ring.column_count; c++) {
+            if (!ColumnSaved(game, header->particle_mode, pools[p], ring.columns[c])) {
+                continue;
+            }
+
+            size_t size = ring.column_sizes[c];
+            size_t position = offset;
+
+            if (ring.columns[c] == game->asteroid_sizes) {
+                sections->asteroid_sizes = offset;
+            }
+
+            //oldest first, however the ring sits
+            for (int s = 0; s < 2; s++) {
+                int start;
+                int length = PoolSegment(&ring, s, &start);
+                AddCopy(list, (char*)ring.columns[c] + start*size, block, position, length*size, to_block);
+                position += length*size;
+            }
+
+            offset = NextSection(block, offset + (size_t)ring.count*size, to_block);
+        }
+    }
+
+    size_t buckets = ChunkCount(game->particles.capacity, PARTICLE_BUCKET_SIZE);
+    AddCopy(list, game->particle_bucket_death, block, offset, sizeof(uint32_t)*buckets, to_block);
+    offset = NextSection(block, offset + sizeof(uint32_t)*buckets, to_block);
+
+    size_t chunks = game->asteroid_chunks.columns*game->asteroid_chunks.rows;
+    sections->cell_start = offset;
+    AddCopy(list, game->asteroid_chunks.cell_start, block, offset, sizeof(int)*(chunks+1), to_block);
+    offset = NextSection(block, offset + sizeof(int)*(chunks+1), to_block);
+
+    sections->active_runs = offset;
+    AddCopy(list, game->active_runs, block, offset, sizeof(int)*2*header->active_run_count, to_block);
+    offset = NextSection(block, offset + sizeof(int)*2*header->active_run_count, to_block);
+
+    return offset;
+}
+
+static void CopyBlocks(void *data, int begin, int end, int chunk) {
+    (void)chunk;
+    const CopyList *list = data;
+    int c = 0;
+
+    for (int b = begin; b < end; b++) {
+        while (list->first_block[c+1] <= b) {
+            c++;
+        }
+
+        const SnapshotCopy *copy = &list->copies[c];
+        size_t offset = (size_t)(b-list->first_block[c])*SNAPSHOT_COPY_BLOCK;
+        size_t bytes = copy->bytes-offset;
+
+        if (bytes > SNAPSHOT_COPY_BLOCK) {
+            bytes = SNAPSHOT_COPY_BLOCK;
+        }
+
+        memcpy(copy->to+offset, copy->from+offset, bytes);
+    }
+}
+
+//Runs every copy in list, cut into SNAPSHOT_COPY_BLOCK pieces dealt out to jobs
+static void RunCopies(CopyList *list, JobSystem *jobs) {
+    int blocks = 0;
+
+    for (int c = 0; c < list->count; c++) {
+        list->first_block[c] = blocks;
+        blocks += (int)((list->copies[c].bytes+SNAPSHOT_COPY_BLOCK-1)/SNAPSHOT_COPY_BLOCK);
+    }
+
+    list->first_block[list->count] = blocks;
+    ParallelFor(jobs, blocks, 1, CopyBlocks, list);
+}
+
+static bool HeaderValid(const Snapshot *snapshot) {
+    SnapshotHeader header;
+
+    if (snapshot->data == NULL || snapshot->size < header_bytes+sizeof(GameData)) {
+        return false;
+    }
+
+    memcpy(&header, snapshot->data, sizeof(header));
+
+    return memcmp(header.magic, magic, 4) == 0
+        && header.version == SNAPSHOT_VERSION
+        && header.game_size == sizeof(GameData)
+        && header.size == snapshot->size;
+}
+
+static bool PoolFits(const EntityPool *pool, const SnapshotHeader *header, int p) {
+    return header->capacity[p] == pool->capacity
+        && header->count[p] >= 0 && header->count[p] <= pool->capacity
+        && header->head[p] >= 0 && (header->head[p] < pool->capacity || header->head[p] == 0);
+}
+
+//Reads the count ints at offset in block, which need not be aligned for int
+static void ReadInts(const unsigned char *block, size_t offset, int *values, int count) {
+    memcpy(values, block+offset, sizeof(int)*count);
+}
+
+/*
+    Whether the asteroid indices a snapshot carries are ones GameStep can
+    follow: runs inside the pool, chunks filed in order up to
+    asteroids_filed, and sizes it has shapes for. Anything else would index
+    past the columns after a restore.
+*/
+static bool IndicesValid(const GameData *game, const SnapshotHeader *header, const unsigned char *block, const SnapshotSections *sections) {
+    int count = header->count[0];
+    int chunks = game->asteroid_chunks.columns*game->asteroid_chunks.rows;
+    int values[2];
+
+    for (int r = 0; r < header->active_run_count; r++) {
+        ReadInts(block, sections->active_runs + sizeof(int)*2*r, values, 2);
+
+        if (values[0] < 0 || values[0] > values[1] || values[1] > count) {
+            return false;
+        }
+    }
+
+    int previous = 0;
+
+    for (int c = 0; c <= chunks; c++) {
+        ReadInts(block, sections->cell_start + sizeof(int)*c, values, 1);
+
+        if ((c == 0 && values[0] != 0) || values[0] < previous) {
+            return false;
+        }
+
+        previous = values[0];
+    }
+
+    if (previous != header->asteroids_filed) {
+        return false;
+    }
+
+    for (int a = 0; a < count; a++) {
+        ReadInts(block, sections->asteroid_sizes + sizeof(int)*a, values, 1);
+
+        if (values[0] < 1 || values[0] > ASTEROID_MAX_SIZE) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//Whether snapshot is from this build and of a game made the same way as game
+static bool SnapshotFits(const GameData *game, const Snapshot *snapshot) {
+    if (!HeaderValid(snapshot)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, snapshot->data, sizeof(header));
+    int chunks = game->asteroid_chunks.columns*game->asteroid_chunks.rows;
+
+    bool fits = (header.particle_mode == PARTICLES_INTEGRATED || header.particle_mode == PARTICLES_ANALYTIC)
+        && PoolFits(&game->asteroids, &header, 0)
+        && PoolFits(&game->particles, &header, 1)
+        && PoolFits(&game->missiles, &header, 2)
+        && header.screen_width == game->screen_width
+        && header.screen_height == game->screen_height
+        && header.world_width == game->world_width
+        && header.world_height == game->world_height
+        && header.active_run_count >= 0 && header.active_run_count <= chunks+1
+        && header.asteroids_filed >= 0 && header.asteroids_filed <= header.count[0];
+
+    if (!fits) {
+        return false;
+    }
+
+    //the counts decide the layout, which has to account for the whole block
+    SnapshotSections sections;
+
+    if (SnapshotLayout(game, &header, NULL, false, NULL, &sections) != snapshot->size) {
+        return false;
+    }
+
+    return IndicesValid(game, &header, snapshot->data, &sections);
+}
+
+/*
+    Snapshot Functions
+*/
+
+bool TakeSnapshot(Snapshot *snapshot, const GameData *game) {
+    if (game->asteroids.dead_count > 0 || game->particles.dead_count > 0 || game->missiles.dead_count > 0) {
+        return false;
+    }
+
+    const EntityPool *pools[] = {&game->asteroids, &game->particles, &game->missiles};
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, magic, 4);
+    header.version = SNAPSHOT_VERSION;
+    header.game_size = sizeof(GameData);
+    header.particle_mode = game->particle_mode;
+    header.screen_width = game->screen_width;
+    header.screen_height = game->screen_height;
+    header.world_width = game->world_width;
+    header.world_height = game->world_height;
+
+    for (int p = 0; p < 3; p++) {
+        header.capacity[p] = pools[p]->capacity;
+        header.head[p] = pools[p]->head;
+        header.count[p] = pools[p]->count;
+    }
+
+    header.asteroids_filed = game->asteroids_filed;
+    header.active_run_count = game->active_run_count;
+
+    size_t size = SnapshotLayout(game, &header, NULL, true, NULL, NULL);
+    header.size = size;
+
+    if (snapshot->capacity < size) {
+        FreeSnapshot(snapshot);
+        //zeroed so the gaps after the header and GameData sections are too
+        snapshot->data = calloc(size, 1);
+
+        if (snapshot->data == NULL) {
+            return false;
+        }
+
+        snapshot->capacity = size;
+    }
+
+    memcpy(snapshot->data, &header, sizeof(header));
+
+    //game's values with every pointer and pool zeroed, the header has what the layout needs
+    GameData *saved = (GameData*)(snapshot->data+header_bytes);
+    memset(saved, 0, sizeof(GameData));
+    CopyGameFields(saved, game);
+
+    CopyList list;
+    list.count = 0;
+    SnapshotLayout(game, &header, snapshot->data, true, &list, NULL);
+    RunCopies(&list, game->jobs);
+
+    snapshot->size = size;
+    return true;
+}
+
+bool RestoreSnapshot(GameData *game, const Snapshot *snapshot) {
+    if (!SnapshotFits(game, snapshot)) {
+        return false;
+    }
+
+    SnapshotHeader header;
+    memcpy(&header, snapshot->data, sizeof(header));
+
+    //the pools first, so running out of memory leaves the other fields alone
+    bool committed = PoolSetLive(&game->asteroids, header.head[0], header.count[0]);
+    committed = PoolSetLive(&game->particles, header.head[1], header.count[1]) && committed;
+    committed = PoolSetLive(&game->missiles, header.head[2], header.count[2]) && committed;
+
+    if (!committed) {
+        PoolSetLive(&game->asteroids, 0, 0);
+        PoolSetLive(&game->particles, 0, 0);
+        PoolSetLive(&game->missiles, 0, 0);
+        game->asteroids_filed = 0;
+        game->active_run_count = 0;
+        return false;
+    }
+
+    CopyGameFields(game, (const GameData*)(snapshot->data+header_bytes));
+
+    //what the layout was worked out from wins over the copies in the GameData section
+    game->screen_width = header.screen_width;
+    game->screen_height = header.screen_height;
+    game->world_width = header.world_width;
+    game->world_height = header.world_height;
+    game->particle_mode = header.particle_mode;
+    game->asteroids_filed = header.asteroids_filed;
+    game->active_run_count = header.active_run_count;
+
+    CopyList list;
+    list.count = 0;
+    SnapshotLayout(game, &header, snapshot->data, false, &list, NULL);
+    RunCopies(&list, game->jobs);
+
+    return true;
+}
+
+bool SaveSnapshot(const Snapshot *snapshot, const char *path) {
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    bool written = fwrite(snapshot->data, 1, snapshot->size, file) == snapshot->size;
+    return fclose(file) == 0 && written;
+}
+
+//Maps the whole of path read only, sets *size to its length
+static void* MapFile(const char *path, size_t *size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER length;
+    void *view = NULL;
+
+    if (file == INVALID_HANDLE_VALUE) {
+        return NULL;
+    }
+
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+        if (mapping != NULL) {
+            //the view keeps the file open
+            view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+
+        *size = (size_t)length.QuadPart;
+    }
+
+    CloseHandle(file);
+    return view;
+#else
+    int file = open(path, O_RDONLY);
+    struct stat info;
+    void *view = NULL;
+
+    if (file < 0) {
+        return NULL;
+    }
+
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        view = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if (view == MAP_FAILED) {
+            view = NULL;
+        }
+
+        *size = info.st_size;
+    }
+
+    //the mapping keeps the file open
+    close(file);
+    return view;
+#endif
+}
+
+static void UnmapFile(void *view, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(view);
+#else
+    munmap(view, size);
+#endif
+}
+
+//Reads the whole of path into a new block
+static bool ReadWholeFile(Snapshot *snapshot, const char *path) {
+    FILE *file = fopen(path, "rb");
+
+    if (file == NULL) {
+        return false;
+    }
+
+    long length = -1;
+
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+    }
+
+    if (length > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        snapshot->data = malloc(length);
+
+        if (snapshot->data != NULL) {
+            snapshot->size = length;
+            snapshot->capacity = length;
+
+            if (fread(snapshot->data, 1, length, file) != (size_t)length) {
+                FreeSnapshot(snapshot);
+            }
+        }
+    }
+
+    fclose(file);
+    return snapshot->data != NULL;
+}
+
+bool LoadSnapshot(Snapshot *snapshot, const char *path, bool map) {
+    FreeSnapshot(snapshot);
+
+    if (map) {
+        snapshot->data = MapFile(path, &snapshot->size);
+
+        if (snapshot->data == NULL) {
+            snapshot->size = 0;
+            return false;
+        }
+    }
+
+    else if (!ReadWholeFile(snapshot, path)) {
+        return false;
+    }
+
+    if (!HeaderValid(snapshot)) {
+        FreeSnapshot(snapshot);
+        return false;
+    }
+
+    return true;
+}
+
+void FreeSnapshot(Snapshot *snapshot) {
+    if (snapshot->data != NULL) {
+
+        if (snapshot->capacity == 0) {
+            UnmapFile(snapshot->data, snapshot->size);
+        }
+
+        else {
+            free(snapshot->data);
+        }
+    }
+
+    snapshot->data = NULL;
+    snapshot->size = 0;
+    snapshot->capacity = 0;
+}
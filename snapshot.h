@@ -0,0 +1,100 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*
+    Save states. A snapshot packs everything GameStep depends on into one
+    block with no pointers in it, so the block can be copied, written out
+    and mapped back in as it is. Restored into a game made with the same
+    InitNewGame and SetWorldSize arguments, it puts that game exactly where
+    it was: the next GameStep plays out the same, which is what rewind and
+    rollback need.
+
+    Block layout, native byte order, each section starting 64 byte aligned:
+
+        SnapshotHeader
+        GameData                the struct's values, its pointers and pools
+                                zeroed so equal games give equal blocks
+        pool columns            asteroids, particles, missiles: each saved
+                                column's live entities, oldest first
+        particle_bucket_death
+        asteroid_chunks.cell_start
+        active_runs
+
+    Section sizes follow from the counts in the header, so the block holds
+    no offsets. Only columns that carry state are saved: particle_flags is
+    rewritten every tick, and the particle clocks the current mode doesn't
+    use (particle_time when analytic, the spawn and death ticks when
+    integrated) are left out.
+
+    A snapshot is for the build that made it. The header holds
+    sizeof(GameData) next to SNAPSHOT_VERSION and both have to match, as
+    do the sizes and capacities the game was made with.
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "game.h"
+
+//Bump whenever the layout above or what goes into it changes
+#define SNAPSHOT_VERSION 2
+
+//Fixed width fields with no padding between them
+typedef struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t game_size;
+    //ParticleMode
+    int32_t particle_mode;
+    //the whole block, header included
+    uint64_t size;
+    int32_t screen_width;
+    int32_t screen_height;
+    int32_t world_width;
+    int32_t world_height;
+    //per pool: asteroids, particles, missiles
+    int32_t capacity[3];
+    int32_t head[3];
+    int32_t count[3];
+    int32_t asteroids_filed;
+    int32_t active_run_count;
+    int32_t unused;
+} SnapshotHeader;
+
+//Zero initialise before first use
+typedef struct Snapshot {
+    unsigned char *data;
+    size_t size;
+    //bytes data has room for, 0 while it is a read only mapping of a file
+    size_t capacity;
+} Snapshot;
+
+/*
+    Packs game into snapshot between GameSteps. The block is reused when it
+    is big enough, so a ring of snapshots kept for rewind allocates nothing
+    once each has grown. The copying is split over game->jobs. Returns
+    false if out of memory or game has kills not yet swept.
+*/
+bool TakeSnapshot(Snapshot *snapshot, const GameData *game);
+/*
+    Puts game back to when snapshot was taken. Returns false, leaving game
+    alone, if snapshot is from another build or a game made differently,
+    or its asteroid runs, chunk starts, sizes or particle mode are out of
+    range as in a truncated or edited file. Also returns false if game
+    can't commit room for the entities: its pools are then left empty with
+    no asteroids filed or active, and every other field as it was.
+*/
+bool RestoreSnapshot(GameData *game, const Snapshot *snapshot);
+
+//Writes the block out as it is
+bool SaveSnapshot(const Snapshot *snapshot, const char *path);
+/*
+    Reads a saved snapshot into memory, or with map, maps the file read
+    only instead: nothing is read until RestoreSnapshot copies straight
+    out of the page cache. Returns false if path is missing or isn't a
+    snapshot from this build.
+*/
+bool LoadSnapshot(Snapshot *snapshot, const char *path, bool map);
+void FreeSnapshot(Snapshot *snapshot);
+
+#endif
@@ -0,0 +1,75 @@
+#include <math.h>
+#include "raylib.h"
+#include "starfield.h"
+
+//Far layer first, it is dimmer and slower
+static const unsigned char layer_brightness[STARFIELD_LAYERS] = {110, 220};
+//0 drifts at background_speed.x, 1 at background_speed.y
+static const float layer_speed[STARFIELD_LAYERS] = {0.0f, 1.0f};
+//Fraction of the camera's movement each layer scrolls by, the far one least
+static const float layer_parallax[STARFIELD_LAYERS] = {0.1f, 0.25f};
+
+void LoadStarfield(Starfield *starfield, int width, int height, unsigned int seed) {
+    Rng rng;
+    RngSeedStream(&rng, seed, RNG_STREAM_STARFIELD);
+
+    starfield->width = width;
+    starfield->height = height;
+
+    for (int l = 0; l < STARFIELD_LAYERS; l++) {
+        RenderTexture2D layer = LoadRenderTexture(width, height);
+        unsigned char brightness = layer_brightness[l];
+
+        BeginTextureMode(layer);
+            ClearBackground(BLANK);
+
+            for (int i = 0; i < STARFIELD_STARS; i++) {
+                Vector2 position = {RngRange(&rng, 0, width-1), RngRange(&rng, 0, height-1)};
+                DrawPixelV(position, (Color){brightness, brightness, brightness, 255});
+            }
+
+        EndTextureMode();
+
+        SetTextureWrap(layer.texture, TEXTURE_WRAP_REPEAT);
+        starfield->layers[l] = layer;
+        starfield->offsets[l] = (Vector2){0, 0};
+    }
+}
+
+void UnloadStarfield(Starfield *starfield) {
+    for (int l = 0; l < STARFIELD_LAYERS; l++) {
+        UnloadRenderTexture(starfield->layers[l]);
+    }
+}
+
+void UpdateStarfield(Starfield *starfield, const GameData *game, float frame_time) {
+    //the heading background particles were given, as a unit vector
+    Vector2 heading = UpdateVelocity((Vector2){0, 0}, 1, game->background_rotation+180, 1);
+
+    for (int l = 0; l < STARFIELD_LAYERS; l++) {
+        //pixels a second, same as a background particle's speed
+        float speed = game->background_speed.x + (game->background_speed.y-game->background_speed.x)*layer_speed[l];
+        Vector2 *offset = &starfield->offsets[l];
+
+        offset->x = fmodf(offset->x + heading.x*speed*frame_time, starfield->width);
+        offset->y = fmodf(offset->y + heading.y*speed*frame_time, starfield->height);
+    }
+}
+
+void DrawStarfield(const Starfield *starfield, int layers, Vector2 view) {
+    for (int l = STARFIELD_LAYERS-layers; l < STARFIELD_LAYERS; l++) {
+        const RenderTexture2D *layer = &starfield->layers[l];
+        Vector2 offset = {
+            fmodf(starfield->offsets[l].x - view.x*layer_parallax[l], starfield->width),
+            fmodf(starfield->offsets[l].y - view.y*layer_parallax[l], starfield->height)
+        };
+
+        //render textures are upside down, so the source moves down to move the stars down
+        DrawTextureRec(
+            layer->texture,
+            (Rectangle){-offset.x, offset.y, (float)starfield->width, (float)-starfield->height},
+            (Vector2){0, 0},
+            WHITE
+        );
+    }
+}
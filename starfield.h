@@ -0,0 +1,40 @@
+#ifndef STARFIELD_H
+#define STARFIELD_H
+
+/*
+    Background stars, drawn once into a screen sized texture per layer and
+    scrolled from then on, so they cost one textured quad a frame and never
+    touch the particle pool.
+
+    The layers drift the way background particles used to: against
+    background_rotation at a speed between the two background_speed values,
+    the far layer slowest. In a world larger than the screen they also
+    follow the camera a little, for depth. Textures wrap, so a layer tiles
+    as it scrolls.
+*/
+
+#include "raylib.h"
+#include "game.h"
+
+#define STARFIELD_LAYERS 2
+//Stars in each layer, the whole budget whatever happens in the game
+#define STARFIELD_STARS 400
+
+typedef struct Starfield {
+    RenderTexture2D layers[STARFIELD_LAYERS];
+    //how far each layer has scrolled, kept within one screen
+    Vector2 offsets[STARFIELD_LAYERS];
+    int width;
+    int height;
+} Starfield;
+
+//Draws the star layers for a width by height screen. Needs a window.
+void LoadStarfield(Starfield *starfield, int width, int height, unsigned int seed);
+void UnloadStarfield(Starfield *starfield);
+
+//Scrolls every layer by frame_time seconds of drift
+void UpdateStarfield(Starfield *starfield, const GameData *game, float frame_time);
+//Draws the nearest layers of the starfield, up to STARFIELD_LAYERS, for a view with its top left at view
+void DrawStarfield(const Starfield *starfield, int layers, Vector2 view);
+
+#endif
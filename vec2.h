@@ -0,0 +1,68 @@
+#ifndef VEC2_H
+#define VEC2_H
+
+/*
+    Small Vector2 helpers for the simulation. These mirror the raymath
+    functions the game used to call so that the simulation does not need
+    raylib to build or run.
+*/
+
+#include <math.h>
+#include <stdbool.h>
+
+//raylib.h defines the same type and sets RL_VECTOR2_TYPE, include it first
+#if !defined(RL_VECTOR2_TYPE)
+typedef struct Vector2 {
+    float x;
+    float y;
+} Vector2;
+#define RL_VECTOR2_TYPE
+#endif
+
+static inline Vector2 Vec2Add(Vector2 a, Vector2 b) {
+    return (Vector2){a.x+b.x, a.y+b.y};
+}
+
+static inline Vector2 Vec2Subtract(Vector2 a, Vector2 b) {
+    return (Vector2){a.x-b.x, a.y-b.y};
+}
+
+static inline Vector2 Vec2Scale(Vector2 v, float scale) {
+    return (Vector2){v.x*scale, v.y*scale};
+}
+
+//angle is in radians
+static inline Vector2 Vec2Rotate(Vector2 v, float angle) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    return (Vector2){v.x*c - v.y*s, v.x*s + v.y*c};
+}
+
+static inline float Vec2Distance(Vector2 a, Vector2 b) {
+    float dx = a.x-b.x;
+    float dy = a.y-b.y;
+    return sqrtf(dx*dx + dy*dy);
+}
+
+static inline bool CirclesOverlap(Vector2 a, float radius_a, Vector2 b, float radius_b) {
+    float dx = a.x-b.x;
+    float dy = a.y-b.y;
+    float r = radius_a+radius_b;
+    return dx*dx + dy*dy <= r*r;
+}
+
+//Even-odd test of a point against a closed polygon
+static inline bool PointInPoly(Vector2 point, const Vector2 *points, int point_count) {
+    bool inside = false;
+
+    for (int i = 0, j = point_count-1; i < point_count; j = i++) {
+        if ((points[i].y > point.y) != (points[j].y > point.y) &&
+            (point.x < (points[j].x-points[i].x)*(point.y-points[i].y)/(points[j].y-points[i].y)+points[i].x)) {
+            inside = !inside;
+        }
+    }
+
+    return inside;
+}
+
+#endif